@@ -1,78 +1,20 @@
-#pragma once
-#include <concepts>
-#include <memory>
+#include <vector>
+#include <iostream>
+#include "../Project62/alloc.h"
 
-template<std::size_t elem_size>
-class MemoryBuffer
+int main()
 {
-private:
-	std::size_t elem_count;
-
-	union MemoryBlock
-	{
-		MemoryBlock* next;
-		std::byte buffer[elem_size];
-	};
-
-	MemoryBlock* begin{ nullptr };
-	MemoryBlock* end{ nullptr };
-
-	struct AllocBlock
-	{
-		AllocBlock* next;
-		const std::size_t size;
-		MemoryBlock* memory_block_array;
-	private:
-		AllocBlock(std::size_t size) : next(nullptr), size(size), memory_block_array(new MemoryBlock[size])
-		{
-			MemoryBlock* iter = memory_block_array;
-			MemoryBlock* last = get_last();
-			while (iter != last)
-			{
-				iter->next = iter + 1;
-				++iter;
-			}
-			iter->next = nullptr;
-		}
-
-	public:
-		~AllocBlock()
-		{
-			delete[] memory_block_array;
-			delete next;
-		}
-
-		MemoryBlock* get_last()
-		{
-			return memory_block_array + size - 1;
-		}
-		
-		static AllocBlock* allocate_new_block(
-			std::size_t size,
-			MemoryBlock** prev_next)
-		{
-			AllocBlock* new_block = new AllocBlock(size);
-			*prev_next = new_block->memory_block_array;
-			return new_block;
-		}
-	};
-
-	AllocBlock* head{ nullptr };
-
-public:
-	MemoryBuffer() : elem_count(0)
-	{
+	MemoryBuffer<8> b{ 8 };
+	std::vector<void*> blocks;
 
-	}
+	for (int count = 0; count < 100; ++count) { blocks.push_back(b.allocate()); }
+	std::cout << "capacity: " << b.capacity() << ", in use: " << b.in_use() << '\n';
 
-	MemoryBuffer(std::size_t init_elem_count) : elem_count(init_elem_count)
-	{
-		head = AllocBlock::allocate_new_block(init_elem_count, &begin);
-		end = head->get_last();
-	}
-};
+	//freed blocks are reused, capacity stays the same
+	for (void* block : blocks) { b.deallocate(block); }
+	for (void*& block : blocks) { block = b.allocate(); }
+	std::cout << "capacity: " << b.capacity() << ", in use: " << b.in_use() << '\n';
 
-int main()
-{
-	MemoryBuffer<8> b{ 8 };
-}
\ No newline at end of file
+	b.release();
+	std::cout << "capacity: " << b.capacity() << ", in use: " << b.in_use() << std::endl;
+}
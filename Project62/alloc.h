@@ -1,48 +1,230 @@
 #pragma once
 #include <concepts>
-//#include <memory>
+#include <cstddef>
+#include <new>
+#include <memory_resource>
 
-template<std::size_t elem_size>
-class MemoryBuffer
+//fixed-size slab pool
+//every allocation is one elem_size block, freed blocks go to an intrusive free list and are reused first
+//when both the free list and the current chunk are exhausted, a new chunk twice as large as the last one is taken
+//as a memory_resource it serves every request that fits in one block, bigger ones are passed to upstream
+template<std::size_t elem_size, std::size_t elem_align = alignof(void*)>
+class MemoryBuffer : public std::pmr::memory_resource
 {
 public:
-	MemoryBuffer() : elem_count(0) {}
-	MemoryBuffer(std::size_t init_elem_count) : elem_count(init_elem_count) {}
+	MemoryBuffer() : MemoryBuffer(default_init_elem_count) {}
+	MemoryBuffer(std::size_t init_elem_count, std::pmr::memory_resource* upstream_resource = std::pmr::get_default_resource()) :
+		upstream(upstream_resource),
+		first_elem_count(init_elem_count ? init_elem_count : 1),
+		next_elem_count(first_elem_count) {}
+
+	MemoryBuffer(const MemoryBuffer&) = delete;
+	MemoryBuffer& operator=(const MemoryBuffer&) = delete;
+
+	~MemoryBuffer() { release(); }
+
+	[[nodiscard]]
+	void* allocate()
+	{
+		if (free_list) { //reuse freed block first
+			MemoryBlock* block = free_list;
+			free_list = block->next;
+			++elem_in_use;
+			return block;
+		}
+
+		if (bump == bump_end) {
+			[[unlikely]];
+			grow();
+		}
+
+		++elem_in_use;
+		return bump++;
+	}
+
+	//count blocks laid out back to back, each one can later be given back on its own with deallocate
+	//taken from the current chunk when it has room, otherwise from a new chunk of exactly count blocks
+	[[nodiscard]]
+	void* allocate_contiguous(std::size_t count)
+	{
+		if (static_cast<std::size_t>(bump_end - bump) < count)
+		{
+			head = AllocBlock::allocate_new_block(count, head);
+			elem_count += count;
+			elem_in_use += count;
+			return head->memory_block_array;
+		}
+
+		MemoryBlock* blocks = bump;
+		bump += count;
+		elem_in_use += count;
+		return blocks;
+	}
+
+	void deallocate(void* memory) noexcept
+	{
+		MemoryBlock* block = static_cast<MemoryBlock*>(memory);
+		block->next = free_list;
+		free_list = block;
+		--elem_in_use;
+	}
+
+	//give every chunk back at once, blocks still handed out become dangling
+	//next chunk starts again from the initial size
+	void release() noexcept
+	{
+		while (head)
+		{
+			AllocBlock* next = head->next;
+			AllocBlock::deallocate_block(head);
+			head = next;
+		}
+		next_elem_count = first_elem_count;
+		free_list = nullptr;
+		bump = bump_end = nullptr;
+		elem_count = 0;
+		elem_in_use = 0;
+	}
+
+	std::size_t capacity() const noexcept { return elem_count; }
+	std::size_t in_use() const noexcept { return elem_in_use; }
+	std::size_t reserved_bytes() const noexcept { return elem_count * sizeof(MemoryBlock); }
+	static constexpr std::size_t block_size() noexcept { return sizeof(MemoryBlock); }
+	std::pmr::memory_resource* upstream_resource() const noexcept { return upstream; }
+
+protected:
+	void* do_allocate(std::size_t bytes, std::size_t alignment) override
+	{
+		if (fits_in_block(bytes, alignment)) { return allocate(); }
+		return upstream->allocate(bytes, alignment);
+	}
+
+	void do_deallocate(void* memory, std::size_t bytes, std::size_t alignment) override
+	{
+		if (fits_in_block(bytes, alignment)) { deallocate(memory); }
+		else { upstream->deallocate(memory, bytes, alignment); }
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+	{
+		return this == &other;
+	}
 
 private:
-	std::size_t elem_count;
+	static constexpr std::size_t default_init_elem_count = 64;
+	//cap on growth so a huge tree does not ask for one enormous contiguous chunk
+	static constexpr std::size_t max_chunk_elem_count = std::size_t{ 1 } << 20;
 
 	union MemoryBlock
 	{
 		MemoryBlock* next;
-		std::byte[elem_size];
+		alignas(elem_align) std::byte buffer[elem_size];
 	};
 
-	MemoryBlock* begin;
-	MemoryBlock* end;
-
 	struct AllocBlock
 	{
 		AllocBlock* next;
+		std::size_t size;
 		MemoryBlock* memory_block_array;
-	private:
-		AllocBlock(std::size_t size) : next(nullptr), memory_block_array(new MemoryBlock[size])
+
+		static AllocBlock* allocate_new_block(std::size_t size, AllocBlock* prev_head)
 		{
-			MemoryBlock* iter = memory_block_array;
-			MemoryBlock* end = memory_block_array + size;
-			while (iter != end)
+			MemoryBlock* array = static_cast<MemoryBlock*>(
+				::operator new(size * sizeof(MemoryBlock), std::align_val_t{ alignof(MemoryBlock) }));
+			try
 			{
-				
-				++iter;
+				return new AllocBlock{ prev_head, size, array };
+			}
+			catch (...)
+			{
+				::operator delete(array, std::align_val_t{ alignof(MemoryBlock) });
+				throw;
 			}
 		}
-	public:
-		
-		static void allocate_new_block(AllocBlock& prev, std::size_t size)
-		{
 
+		static void deallocate_block(AllocBlock* block) noexcept
+		{
+			::operator delete(block->memory_block_array, std::align_val_t{ alignof(MemoryBlock) });
+			delete block;
 		}
 	};
 
-	
-};
\ No newline at end of file
+	static constexpr bool fits_in_block(std::size_t bytes, std::size_t alignment) noexcept
+	{
+		return bytes <= sizeof(MemoryBlock) && alignment <= alignof(MemoryBlock);
+	}
+
+	void grow()
+	{
+		head = AllocBlock::allocate_new_block(next_elem_count, head);
+		bump = head->memory_block_array;
+		bump_end = bump + head->size;
+		elem_count += head->size;
+		if (next_elem_count < max_chunk_elem_count) { next_elem_count *= 2; }
+	}
+
+	std::pmr::memory_resource* upstream;
+	MemoryBlock* free_list{ nullptr };
+	MemoryBlock* bump{ nullptr };
+	MemoryBlock* bump_end{ nullptr };
+	AllocBlock* head{ nullptr };
+	const std::size_t first_elem_count;
+	std::size_t next_elem_count;
+	std::size_t elem_count{ 0 };
+	std::size_t elem_in_use{ 0 };
+};
+
+//memory_resource in front of another one, counting what passes through it
+//bytes are the ones asked for, whatever upstream adds on top of them is not seen here
+//fragmentation is the share of the peak no longer in use, behind a resource that keeps what it was given
+//(a node pool, a monotonic buffer) that is the share of its memory lying idle
+//like std::pmr::unsynchronized_pool_resource, one thread at a time
+class CountingResource : public std::pmr::memory_resource
+{
+public:
+	explicit CountingResource(std::pmr::memory_resource* upstream_resource = std::pmr::get_default_resource()) : upstream(upstream_resource) {}
+
+	CountingResource(const CountingResource&) = delete;
+	CountingResource& operator=(const CountingResource&) = delete;
+
+	std::size_t live_bytes() const noexcept { return live; }
+	std::size_t peak_bytes() const noexcept { return peak; }
+	//every allocation so far, including the ones already given back
+	std::size_t allocation_count() const noexcept { return allocations; }
+	std::size_t live_allocation_count() const noexcept { return live_allocations; }
+	double fragmentation() const noexcept { return peak ? 1.0 - static_cast<double>(live) / static_cast<double>(peak) : 0.0; }
+	std::pmr::memory_resource* upstream_resource() const noexcept { return upstream; }
+
+	//start measuring the peak again from what is live now
+	void reset_peak() noexcept { peak = live; }
+
+protected:
+	void* do_allocate(std::size_t bytes, std::size_t alignment) override
+	{
+		void* memory = upstream->allocate(bytes, alignment);
+		live += bytes;
+		if (live > peak) { peak = live; }
+		++allocations;
+		++live_allocations;
+		return memory;
+	}
+
+	void do_deallocate(void* memory, std::size_t bytes, std::size_t alignment) override
+	{
+		upstream->deallocate(memory, bytes, alignment);
+		live -= bytes;
+		--live_allocations;
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+	{
+		return this == &other;
+	}
+
+private:
+	std::pmr::memory_resource* upstream;
+	std::size_t live{ 0 };
+	std::size_t peak{ 0 };
+	std::size_t allocations{ 0 };
+	std::size_t live_allocations{ 0 };
+};
@@ -0,0 +1,2208 @@
+#pragma once
+#include <concepts>
+#include <memory>
+#include <iostream>
+#include <optional>
+#include <exception>
+#include <stdexcept>
+#include <utility>
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+#include <tuple>
+#include <memory_resource>
+#include <future>
+#include <thread>
+#include <bit>
+#include <limits>
+#include <compare>
+#include <functional>
+#include <span>
+#include <filesystem>
+#include <array>
+#include <atomic>
+#if defined(_MSC_VER) || defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+#include "alloc.h"
+#include "frozen.h"
+
+//concept std::like in C++23
+template<typename T, typename U>
+concept is_cvref_t_of = std::is_same_v<U, std::remove_cvref_t<T>>;
+
+#define UNREACHABLE_BUILDIN_WRAPPER __assume(false)
+#define assert(expression) do { if(!(expression)) { throw std::runtime_error{ "WTF" }; } } while(false)
+
+//MSVC only honors its own spelling, and silently ignores the standard one
+#ifdef _MSC_VER
+#define AVL_NO_UNIQUE_ADDRESS [[msvc::no_unique_address]]
+#else
+#define AVL_NO_UNIQUE_ADDRESS [[no_unique_address]]
+#endif
+
+//hint the cache line of a node that is about to be read, it does nothing where no prefetch is known
+#if defined(_MSC_VER) || defined(__SSE__)
+#define AVL_PREFETCH(ADDRESS) _mm_prefetch(reinterpret_cast<const char*>(ADDRESS), _MM_HINT_T0)
+#elif defined(__GNUC__)
+#define AVL_PREFETCH(ADDRESS) __builtin_prefetch(ADDRESS)
+#else
+#define AVL_PREFETCH(ADDRESS) ((void)(ADDRESS))
+#endif
+
+//define AVL_STATS, for the whole program, to have every AVL count what its hot paths do, see AVL::stats()
+//without it the counters are not even members and every count compiles to nothing
+//with it the counts are relaxed atomic adds, so lookups from many threads under a shared lock stay safe
+#ifdef AVL_STATS
+#define AVL_STAT_ADD(COUNTER, AMOUNT) (_stats.COUNTER.fetch_add((AMOUNT), std::memory_order_relaxed))
+#else
+#define AVL_STAT_ADD(COUNTER, AMOUNT) ((void)0)
+#endif
+
+//what an AVL counted, a plain copy taken by AVL::stats()
+struct avl_stats
+{
+#ifdef AVL_STATS
+	static constexpr bool is_enabled = true;
+#else
+	static constexpr bool is_enabled = false;
+#endif
+	//deeper lookups than this are counted in the last bucket, an AVL of 2^44 nodes is still shallower
+	static constexpr std::size_t depth_buckets = 64;
+
+	//lookups are the ones made by find, a lookup compares its key once with every node it visits
+	std::uint64_t lookups = 0;
+	std::uint64_t lookup_comparisons = 0;
+	//lookup_depths[d] is how many lookups visited d nodes, so a hit on the root is at 1 and a lookup in an empty tree at 0
+	std::array<std::uint64_t, depth_buckets> lookup_depths{};
+	//made by rebalancing after insert, erase, join and split
+	std::uint64_t single_rotations = 0;
+	std::uint64_t double_rotations = 0;
+	//a retrace walks from a changed node up to the first ancestor keeping its height, each node on the way is a step
+	std::uint64_t retraces = 0;
+	std::uint64_t retrace_steps = 0;
+	std::uint64_t node_allocations = 0;
+	std::uint64_t node_frees = 0;
+	//insert_or_assign of a key already in the tree
+	std::uint64_t overwrites = 0;
+
+	double comparisons_per_lookup() const { return lookups ? static_cast<double>(lookup_comparisons) / static_cast<double>(lookups) : 0; }
+	double steps_per_retrace() const { return retraces ? static_cast<double>(retrace_steps) / static_cast<double>(retraces) : 0; }
+
+	friend std::ostream& operator<<(std::ostream& out, const avl_stats& stats)
+	{
+		out << "Lookups: " << stats.lookups << ", comparisons per lookup: " << stats.comparisons_per_lookup() << '\n';
+		out << "Lookup depths:";
+		for (std::size_t depth = 0; depth < depth_buckets; ++depth)
+		{
+			if (stats.lookup_depths[depth]) { out << ' ' << depth << ':' << stats.lookup_depths[depth]; }
+		}
+		out << '\n';
+		out << "Rotations: " << stats.single_rotations << " single, " << stats.double_rotations << " double\n";
+		out << "Retraces: " << stats.retraces << ", steps per retrace: " << stats.steps_per_retrace() << '\n';
+		out << "Nodes allocated: " << stats.node_allocations << ", freed: " << stats.node_frees
+			<< ", overwrites: " << stats.overwrites << '\n';
+		return out;
+	}
+};
+
+//how many threads the bulk operations of AVL may use, 1 keeps them on the calling thread
+struct parallel_policy
+{
+	unsigned thread_count = 1;
+};
+
+//ordering of AVL keys, either a less-style predicate like std::map takes
+//or a three-way comparator like std::compare_three_way, which tells less / equal / greater in one call
+template<typename _Compare, typename _KeyTy>
+concept key_compare_for = std::strict_weak_order<_Compare, _KeyTy, _KeyTy>
+	|| requires(const _Compare& comp, const _KeyTy& key) { { comp(key, key) } -> std::convertible_to<std::partial_ordering>; };
+
+//std::less only forwards to operator<, so operator<=> of the same types orders the keys the same way
+template<typename _Compare>
+inline constexpr bool is_plain_less = false;
+template<typename T>
+inline constexpr bool is_plain_less<std::less<T>> = true;
+
+//less, equal or greater with one comparison where the comparator allows it
+//so a descent pays one string compare per level instead of an == and a >
+template<typename _Compare>
+auto key_three_way(const _Compare& comp, const auto& lhs, const auto& rhs)
+{
+	using _LhsTy = std::remove_cvref_t<decltype(lhs)>;
+	using _RhsTy = std::remove_cvref_t<decltype(rhs)>;
+	if constexpr (!std::is_convertible_v<decltype(comp(lhs, rhs)), bool>) { return comp(lhs, rhs); }
+	else if constexpr (is_plain_less<_Compare> && std::three_way_comparable_with<_LhsTy, _RhsTy>) { return lhs <=> rhs; }
+	else
+	{
+		if (comp(lhs, rhs)) { return std::weak_ordering::less; }
+		if (comp(rhs, lhs)) { return std::weak_ordering::greater; }
+		return std::weak_ordering::equivalent;
+	}
+}
+
+template<typename _Compare>
+bool key_less(const _Compare& comp, const auto& lhs, const auto& rhs)
+{
+	if constexpr (!std::is_convertible_v<decltype(comp(lhs, rhs)), bool>) { return comp(lhs, rhs) < 0; }
+	else { return comp(lhs, rhs); }
+}
+
+//an aggregate policy folds the entries of a subtree into one value kept in its root node
+//lift(key, value) is the value of one entry, combine must be associative and identity its neutral element
+//combine is always called with the lower keys on the left, so it does not have to be commutative
+template<typename _Policy, typename _KeyTy, typename _ValTy>
+concept aggregate_policy = requires(const _KeyTy& key, const _ValTy& value, const typename _Policy::type& aggregate)
+{
+	{ _Policy::identity() } -> std::convertible_to<typename _Policy::type>;
+	{ _Policy::lift(key, value) } -> std::convertible_to<typename _Policy::type>;
+	{ _Policy::combine(aggregate, aggregate) } -> std::convertible_to<typename _Policy::type>;
+};
+
+template<typename T>
+struct sum_aggregate
+{
+	using type = T;
+	static T identity() { return T{}; }
+	static T lift(const auto&, const T& value) { return value; }
+	static T combine(const T& lhs, const T& rhs) { return lhs + rhs; }
+};
+
+template<typename T>
+struct min_aggregate
+{
+	using type = T;
+	static T identity() { return std::numeric_limits<T>::max(); }
+	static T lift(const auto&, const T& value) { return value; }
+	static T combine(const T& lhs, const T& rhs) { return std::min(lhs, rhs); }
+};
+
+template<typename T>
+struct max_aggregate
+{
+	using type = T;
+	static T identity() { return std::numeric_limits<T>::lowest(); }
+	static T lift(const auto&, const T& value) { return value; }
+	static T combine(const T& lhs, const T& rhs) { return std::max(lhs, rhs); }
+};
+
+//_is_order_statistic keeps the size of every subtree in its root node
+//it enables rank / select / count_range / median in O(log n), at the cost of 8 more bytes per node
+//and of updating the sizes on the whole insert / erase path instead of stopping where the height settles
+//_Aggregate, when not void, keeps the aggregate of every subtree in its root node, see aggregate_policy
+//values can then only be changed through insert / insert_or_assign, find and iterators hand out const values
+//_Compare comes before them like it does for std::map, see key_compare_for
+//with a transparent _Compare, lookups take any key type it can compare, e.g. std::string_view for std::string keys
+template<typename _KeyTy, typename _ValTy, typename _Compare = std::less<_KeyTy>,
+	bool _is_order_statistic = false, typename _Aggregate = void>
+requires key_compare_for<_Compare, _KeyTy> && (std::is_void_v<_Aggregate> || aggregate_policy<_Aggregate, _KeyTy, _ValTy>)
+class AVL
+{
+public:
+	using key_type = _KeyTy;
+	using value_type = _ValTy;
+	using allocator_type = std::pmr::polymorphic_allocator<>;
+	using key_compare = _Compare;
+private:
+#define FWD(FORWARD_REF) std::forward<decltype(FORWARD_REF)>(FORWARD_REF)
+
+	static constexpr bool _is_transparent = requires { typename _Compare::is_transparent; };
+
+	//the other overload already takes key_type, so this one is only for a different type of key
+	template<typename _LookupTy>
+	static constexpr bool _is_other_lookup = _is_transparent && !std::is_same_v<std::remove_cvref_t<_LookupTy>, key_type>;
+
+	enum class is_height_updated : bool
+	{
+		HEIGHT_UPDATE_NO_NEED = false, HEIGHT_UPDATE_NEEDED = true
+	};
+
+	struct _no_count {};
+	using _count_type = std::conditional_t<_is_order_statistic, std::size_t, _no_count>;
+
+	static constexpr _count_type _leaf_count()
+	{
+		if constexpr (_is_order_statistic) { return 1; }
+		else { return {}; }
+	}
+
+	static constexpr bool _has_aggregate = !std::is_void_v<_Aggregate>;
+	static constexpr bool _is_augmented = _is_order_statistic || _has_aggregate;
+
+	struct _no_aggregate {};
+	using _aggregate_type = typename std::conditional_t<_has_aggregate, _Aggregate, std::type_identity<_no_aggregate>>::type;
+
+	static _aggregate_type _lift(const key_type& key, const value_type& value)
+	{
+		if constexpr (_has_aggregate) { return _Aggregate::lift(key, value); }
+		else { return {}; }
+	}
+
+	//what find and iterators hand out, a value changed behind the tree's back would leave the aggregates stale
+	using _exposed_value_type = std::conditional_t<_has_aggregate, const value_type, value_type>;
+
+	//children are owned by the tree, not by the node
+	//nodes are created and destroyed only through _new_node / _delete_node so they go back to the tree's resource
+	//key and links come first so a descent only reads the front of the node
+	//height of an AVL tree never gets near 255, one byte is enough and it sits in the padding after small keys
+	//for AVL<int, double> the node is 32 bytes, two nodes per cache line
+	class _Node
+	{
+	public:
+		key_type _key;
+		std::uint8_t _height = 1;
+		_Node* _child_left;
+		_Node* _child_right;
+		//number of nodes in this subtree, takes no room without _is_order_statistic
+		AVL_NO_UNIQUE_ADDRESS _count_type _count = _leaf_count();
+		value_type _value;
+		//aggregate of this subtree, takes no room without _Aggregate
+		AVL_NO_UNIQUE_ADDRESS _aggregate_type _aggregate = _lift(_key, _value);
+
+		_Node(is_cvref_t_of<key_type> auto&& _new_key,
+			auto&&... _value_args) :
+			_key(FWD(_new_key)),
+			_child_left(nullptr), _child_right(nullptr),
+			_value(FWD(_value_args)...) {}
+
+		//size and aggregate are refreshed whether the height changes or not
+		is_height_updated _update_height()
+		{
+			_update_augment();
+			auto new_height = 1 + std::max(_get_height(_child_left), _get_height(_child_right));
+			if (new_height == _height) {
+				return is_height_updated::HEIGHT_UPDATE_NO_NEED;
+			} else {
+				_height = static_cast<std::uint8_t>(new_height);
+				return is_height_updated::HEIGHT_UPDATE_NEEDED;
+			}
+		}
+
+		void _update_augment()
+		{
+			if constexpr (_is_order_statistic) { _count = 1 + _get_count(_child_left) + _get_count(_child_right); }
+			if constexpr (_has_aggregate)
+			{
+				_aggregate = _Aggregate::combine(
+					_Aggregate::combine(_get_aggregate(_child_left), _Aggregate::lift(_key, _value)),
+					_get_aggregate(_child_right));
+			}
+		}
+
+		//turn a detached node back into a leaf
+		void _reset_leaf()
+		{
+			_child_left = nullptr;
+			_child_right = nullptr;
+			_height = 1;
+			_count = _leaf_count();
+			_aggregate = _lift(_key, _value);
+		}
+
+		int _get_balance()
+		{
+			return _get_height(_child_right) - _get_height(_child_left);
+		}
+	};
+
+public:
+	//a pool sized for this tree's nodes, can be shared by several trees of the same type
+	using node_pool_type = MemoryBuffer<sizeof(_Node), alignof(_Node)>;
+
+private:
+	static int _get_height(_Node* child)
+	{
+		return child ? (child->_height) : 0;
+	}
+
+	static std::size_t _get_count(_Node* child) requires _is_order_statistic
+	{
+		return child ? child->_count : 0;
+	}
+
+	static _aggregate_type _get_aggregate(_Node* child) requires _has_aggregate
+	{
+		return child ? child->_aggregate : _Aggregate::identity();
+	}
+
+	auto _compare(const auto& lhs, const auto& rhs) const { return key_three_way(_comp, lhs, rhs); }
+	bool _less(const auto& lhs, const auto& rhs) const { return key_less(_comp, lhs, rhs); }
+
+	_Node* _new_node(auto&&... args)
+	{
+		std::pmr::polymorphic_allocator<_Node> alloc{ _alloc };
+		AVL_STAT_ADD(node_allocations, 1);
+		return alloc.template new_object<_Node>(FWD(args)...);
+	}
+
+	void _delete_node(_Node* node)
+	{
+		std::pmr::polymorphic_allocator<_Node> alloc{ _alloc };
+		AVL_STAT_ADD(node_frees, 1);
+		alloc.delete_object(node);
+	}
+
+	//O(n) without recursion or a stack: a node with a left child is rotated right until the root has none,
+	//then the root is released and its right child takes its place
+	//every node is rotated at most once, it never gets a left child again
+	void _destroy_impl(_Node* root)
+	{
+		while (root)
+		{
+			if (_Node* left = root->_child_left)
+			{
+				root->_child_left = left->_child_right;
+				left->_child_right = root;
+				root = left;
+			}
+			else
+			{
+				_Node* right = root->_child_right;
+				_delete_node(root);
+				root = right;
+			}
+		}
+	}
+
+	//nodes of such a tree can be dropped without visiting them:
+	//they have nothing to destroy, and they live in a monotonic buffer, whose deallocate does nothing anyway,
+	//or, with _is_pool_dropped, in a pool only this tree uses and that goes away with it
+	//every tree allocating from an own pool holds a share of it (split results, node handles, moved-from trees),
+	//so use_count() == 1 means no other tree has a node there
+	//a tree that lives on gives every node back, the pool may be serving others that took get_allocator()
+	template<bool _is_pool_dropped>
+	bool _is_arena() const
+	{
+		if constexpr (!std::is_trivially_destructible_v<_Node>) { return false; }
+		else
+		{
+			if (_own_pool) { return _is_pool_dropped && _own_pool.use_count() == 1; }
+			return dynamic_cast<std::pmr::monotonic_buffer_resource*>(_alloc.resource()) != nullptr;
+		}
+	}
+
+	//drop every node and leave the tree empty
+	//_is_pool_dropped is for the destructor and move assignment, an own pool is then given back whole
+	template<bool _is_pool_dropped = false>
+	void _clear_impl()
+	{
+		if (_is_arena<_is_pool_dropped>())
+		{
+			AVL_STAT_ADD(node_frees, _size);
+			if (_own_pool) { _own_pool->release(); }
+		}
+		else { _destroy_impl(_head); }
+		_head = nullptr;
+		_size = 0;
+	}
+
+	//copy pair-like elements out, sorted by key, with only the last one of each key kept
+	template<std::input_iterator _It>
+	std::vector<std::pair<key_type, value_type>> _sort_unique(_It first, _It last) const
+	{
+		std::vector<std::pair<key_type, value_type>> elements(first, last);
+		std::stable_sort(elements.begin(), elements.end(),
+			[this](const auto& lhs, const auto& rhs) { return _less(lhs.first, rhs.first); });
+
+		auto output = elements.begin();
+		for (auto run = elements.begin(); run != elements.end();)
+		{
+			auto run_end = std::next(run);
+			while (run_end != elements.end() && !_less(run->first, run_end->first)) { ++run_end; }
+			if (output != std::prev(run_end)) { *output = std::move(*std::prev(run_end)); }
+			++output;
+			run = run_end;
+		}
+		elements.erase(output, elements.end());
+		return elements;
+	}
+
+	//link nodes [first, last) that are already in key order into a perfectly balanced subtree
+	//the middle node becomes the root, so the two halves differ by at most one node
+	static _Node* _link_sorted(auto&& node_at, std::size_t first, std::size_t last)
+	{
+		if (first == last) { return nullptr; }
+		std::size_t middle = first + (last - first) / 2;
+		_Node* root = node_at(middle);
+		root->_child_left = _link_sorted(node_at, first, middle);
+		root->_child_right = _link_sorted(node_at, middle + 1, last);
+		root->_update_height();
+		return root;
+	}
+
+#define AVL_ROTATE_OPERATION(COUNTER_ROTATE_DIRECTION, ROTATE_DIRECTION)        \
+    _Node* new_root = old_root->_child_##COUNTER_ROTATE_DIRECTION;              \
+    old_root->_child_##COUNTER_ROTATE_DIRECTION = new_root->_child_##ROTATE_DIRECTION; \
+    old_root->_update_height();                                                 \
+    new_root->_child_##ROTATE_DIRECTION = old_root;                             \
+    new_root->_update_height();                                                 \
+    return new_root
+
+	static _Node* _right_rotate(_Node* old_root)
+	{
+		AVL_ROTATE_OPERATION(left, right);
+	}
+
+	static _Node* _left_rotate(_Node* old_root)
+	{
+		AVL_ROTATE_OPERATION(right, left);
+	}
+
+#undef AVL_ROTATE_OPERATION
+
+	_Node* _find_impl(const auto& key)
+	{
+		_Node* iter = this->_head;
+		[[maybe_unused]] std::size_t depth = 0;
+		while (iter)
+		{
+			++depth;
+			auto order = _compare(key, iter->_key);
+			if (order == 0) { break; }
+			if (order > 0) { iter = iter->_child_right; }
+			else { iter = iter->_child_left; }
+		}
+		_count_lookup(depth);
+		return iter;
+	}
+
+	//lookups in flight at once, enough to cover a memory miss with the work of the others
+	static constexpr std::size_t _batch_width = 16;
+
+	//advance up to _batch_width descents in turns, each one prefetches its next node and yields to the others
+	//a finished lookup hands its slot to the next key, so the window stays full until the keys run out
+	template<typename _OutTy>
+	void _find_batch_impl(std::span<const key_type> keys, std::span<_OutTy*> out) const
+	{
+		if (out.size() < keys.size()) { throw std::out_of_range{ "find_batch: out is shorter than keys" }; }
+		if (!_head)
+		{
+			std::fill_n(out.begin(), keys.size(), nullptr);
+			return;
+		}
+
+		_Node* cursor[_batch_width];
+		std::size_t cursor_key[_batch_width];
+		//nodes compared so far by each lookup, for the stats like _find_impl counts them
+		[[maybe_unused]] std::size_t cursor_depth[_batch_width];
+		std::size_t active = 0;
+		std::size_t next_key = 0;
+		for (; active < _batch_width && next_key < keys.size(); ++active, ++next_key)
+		{
+			cursor[active] = _head;
+			cursor_key[active] = next_key;
+			cursor_depth[active] = 0;
+		}
+
+		while (active)
+		{
+			for (std::size_t slot = 0; slot < active;)
+			{
+				_Node* node = cursor[slot];
+				auto order = _compare(keys[cursor_key[slot]], node->_key);
+				++cursor_depth[slot];
+				_Node* next = order > 0 ? node->_child_right : node->_child_left;
+				if (order != 0 && next)
+				{
+					AVL_PREFETCH(next);
+					cursor[slot++] = next;
+					continue;
+				}
+
+				out[cursor_key[slot]] = order == 0 ? &(node->_value) : nullptr;
+				_count_lookup(cursor_depth[slot]);
+				if (next_key < keys.size())
+				{
+					cursor[slot] = _head;
+					cursor_depth[slot] = 0;
+					cursor_key[slot++] = next_key++;
+				}
+				else
+				{
+					//the last lookup in flight takes this slot and still gets its turn in this round
+					--active;
+					cursor[slot] = cursor[active];
+					cursor_key[slot] = cursor_key[active];
+					cursor_depth[slot] = cursor_depth[active];
+				}
+			}
+		}
+	}
+
+	void _rebalance(_Node*& root) const
+	{
+		auto balance = root->_get_balance();
+		_Node** child = nullptr;
+		unsigned char _case = 0;
+		constexpr char LL = 0b00000000;
+		constexpr char LR = 0b00000001;
+		constexpr char RL = 0b00000010;
+		constexpr char RR = 0b00000011;
+
+		if (balance > 1) {
+			_case |= 0b00000010;
+			child = &(root->_child_right);
+		} else {
+			child = &(root->_child_left);
+		}
+
+		//a child with balance 0 only shows up after erase or join, a single rotation is the right fix for it
+		balance = (*child)->_get_balance();
+		if (balance > 0 || (balance == 0 && (_case & 0b00000010))) {
+			_case |= 0b00000001;
+		}
+
+		switch (_case)
+		{
+		case LR:
+			*child = _left_rotate(*child);
+			AVL_STAT_ADD(double_rotations, 1);
+			root = _right_rotate(root);
+			break;
+		case LL:
+			AVL_STAT_ADD(single_rotations, 1);
+			root = _right_rotate(root);
+			break;
+		case RL:
+			*child = _right_rotate(*child);
+			AVL_STAT_ADD(double_rotations, 1);
+			root = _left_rotate(root);
+			break;
+		case RR:
+			AVL_STAT_ADD(single_rotations, 1);
+			root = _left_rotate(root);
+			break;
+		}
+	}
+
+	is_height_updated _further_update(_Node*& root) const
+	{
+		AVL_STAT_ADD(retrace_steps, 1);
+		auto balance = root->_get_balance();
+		if (balance > -2 && balance < 2) { //-1, 0, 1 rebalance no need
+			return root->_update_height();
+		}
+
+		//need rebalance
+		auto old_height = _get_height(root);
+		_rebalance(root);
+		//if height is changed, tell parent node that it also needs some check
+		if (old_height != _get_height(root)) { return is_height_updated::HEIGHT_UPDATE_NEEDED; }
+		else { return is_height_updated::HEIGHT_UPDATE_NO_NEED; }
+	}
+
+	//AVL height is below 1.44 * log2(n + 2), 64 levels is more nodes than fit in the address space
+	static constexpr std::size_t _max_depth = 64;
+	//links from _head down to the current position, the retrace walks it back upwards
+	using _path_type = _Node** [_max_depth];
+
+	//update ancestors on the path from the deepest one, stop rebalancing once a subtree keeps its height
+	//subtree sizes and aggregates above that point still change, so they alone are refreshed further up
+	//returns the highest depth a rotation happened at, links in path up to and including it are still right
+	//when nothing rotated it returns depth, and the whole path is still right
+	std::size_t _retrace(_path_type& path, std::size_t depth) const
+	{
+		AVL_STAT_ADD(retraces, 1);
+		std::size_t rotated_at = depth;
+		while (depth)
+		{
+			_Node* old_root = *path[--depth];
+			auto is_updated = _further_update(*path[depth]);
+			if (*path[depth] != old_root) { rotated_at = depth; }
+			if (is_updated == is_height_updated::HEIGHT_UPDATE_NO_NEED) { break; }
+		}
+		if constexpr (_is_augmented)
+		{
+			while (depth) { (*path[--depth])->_update_augment(); }
+		}
+		return rotated_at;
+	}
+
+	//returns the node holding key and whether it was just created
+	//an existing node is kept in place, with _is_assign its value is overwritten, otherwise it is left alone
+	template<bool _is_assign>
+	std::pair<_Node*, bool> _push_impl(
+		is_cvref_t_of<key_type> auto&& key,
+		auto&&... value_args)
+	{
+		_path_type path;
+		std::size_t depth = 0;
+		_Node** link = &(this->_head);
+		return _push_below<_is_assign, false>(path, depth, link, FWD(key), FWD(value_args)...);
+	}
+
+	//the descent of _push_impl from link down, path[0, depth) holding the links from _head to link
+	//with _is_path_kept, path[0, depth) and link lead to the node holding key on return,
+	//the part below a rotation of the retrace is found again by comparing keys from where it happened
+	template<bool _is_assign, bool _is_path_kept>
+	std::pair<_Node*, bool> _push_below(
+		_path_type& path, std::size_t& depth, _Node**& link,
+		is_cvref_t_of<key_type> auto&& key,
+		auto&&... value_args)
+	{
+		while (*link)
+		{
+			auto order = _compare(key, (*link)->_key);
+			if (order == 0) { //key has existed, reuse the node
+				if constexpr (_is_assign)
+				{
+					(((*link)->_value = FWD(value_args)), ...);
+					AVL_STAT_ADD(overwrites, 1);
+					//the new value changes the aggregate of every subtree holding it
+					if constexpr (_has_aggregate)
+					{
+						(*link)->_update_augment();
+						for (std::size_t index = depth; index;) { (*path[--index])->_update_augment(); }
+					}
+				}
+				return { *link, false };
+			}
+
+			[[likely]];
+			//not yet find the right place
+			path[depth++] = link;
+			if (order > 0) { link = &((*link)->_child_right); }
+			else { link = &((*link)->_child_left); }
+		}
+
+		//no one is here, so here is the home of new node
+		_Node* new_node = _new_node(FWD(key), FWD(value_args)...);
+		*link = new_node;
+		++_size;
+		std::size_t rotated_at = _retrace(path, depth);
+		if constexpr (_is_path_kept)
+		{
+			if (rotated_at < depth)
+			{
+				depth = rotated_at;
+				link = path[depth];
+				while (*link != new_node)
+				{
+					path[depth++] = link;
+					if (_less(new_node->_key, (*link)->_key)) { link = &((*link)->_child_left); }
+					else { link = &((*link)->_child_right); }
+				}
+			}
+		}
+		return { new_node, true };
+	}
+
+	//_push_impl starting from the deepest node on path whose subtree has room for key
+	//path[0, depth] are the links from _head to the node the search starts near, path[depth] leading to it
+	//from there up, only the nearest ancestor it is right of and the nearest it is left of bound that subtree,
+	//ancestors are compared with key until both such bounds hold, so a key next to that node costs O(1) comparisons
+	//on return path[0, depth] lead to the node holding key in the same way
+	template<bool _is_assign>
+	std::pair<_Node*, bool> _push_near(
+		_path_type& path, std::size_t& depth,
+		is_cvref_t_of<key_type> auto&& key,
+		auto&&... value_args)
+	{
+		std::size_t top = depth;
+		bool is_low_known = false;
+		bool is_high_known = false;
+		for (std::size_t index = depth; index-- > 0 && !(is_low_known && is_high_known);)
+		{
+			_Node* parent = *path[index];
+			bool is_right_child = path[index + 1] == &(parent->_child_right);
+			bool& is_known = is_right_child ? is_low_known : is_high_known;
+			if (is_known) { continue; }
+			auto order = _compare(key, parent->_key);
+			if (is_right_child ? order > 0 : order < 0) { is_known = true; }
+			else { top = index; }
+		}
+
+		depth = top;
+		_Node** link = path[top];
+		auto result = _push_below<_is_assign, true>(path, depth, link, FWD(key), FWD(value_args)...);
+		path[depth] = link;
+		return result;
+	}
+
+	//links from _head to the node of it in path[0, depth], just the link of _head for end or an iterator of another tree
+	void _path_of(const auto& it, _path_type& path, std::size_t& depth)
+	{
+		path[0] = &_head;
+		depth = 0;
+		if (it._root != &_head) { return; }
+		for (; depth + 1 < it._depth; ++depth)
+		{
+			_Node* node = it._path[depth];
+			path[depth + 1] = node->_child_right == it._path[depth + 1] ? &(node->_child_right) : &(node->_child_left);
+		}
+	}
+
+	auto _iterator_of(const _path_type& path, std::size_t depth)
+	{
+		iterator result;
+		result._root = &_head;
+		if (*path[depth])
+		{
+			for (; result._depth <= depth; ++result._depth) { result._path[result._depth] = *path[result._depth]; }
+		}
+		return result;
+	}
+
+	void _remove_impl(const auto& key)
+	{
+		if (_Node* node = _unlink_impl(key)) { _delete_node(node); }
+	}
+
+	//take the node holding key out of the tree and hand it back, null when key is not in the tree
+	_Node* _unlink_impl(const auto& key)
+	{
+		_path_type path;
+		std::size_t depth = 0;
+		_Node** link = &(this->_head);
+
+		while (true)
+		{
+			if (!*link) //fail to find a node to remove
+			{
+				[[unlikely]];
+				return nullptr;
+			}
+
+			auto order = _compare(key, (*link)->_key);
+			if (order == 0) { break; } //succeed to find the node needs removed
+
+			path[depth++] = link;
+			if (order > 0) { link = &((*link)->_child_right); }
+			else { link = &((*link)->_child_left); }
+		}
+
+		_Node* ready_to_release = *link;
+		--_size;
+
+		if (!(ready_to_release->_child_right))
+		{
+			//if the removing node has no right child, replace it directly with its left child
+			*link = ready_to_release->_child_left;
+		}
+		else if (!(ready_to_release->_child_left))
+		{
+			//do the same thing with left child
+			*link = ready_to_release->_child_right;
+		}
+		else
+		{
+			//find the most right node on the left child tree and let it move to here
+			//NOTE: in a well-maintained AVL tree, such node shall have a left child tree with 0 or 1 height
+			//every node passed on the way down is an ancestor of the spliced out position, so they join the path
+			std::size_t replaced_at = depth;
+			path[depth++] = link;
+			_Node** most_right = &(ready_to_release->_child_left);
+			while ((*most_right)->_child_right)
+			{
+				path[depth++] = most_right;
+				most_right = &((*most_right)->_child_right);
+			}
+
+			//replace the most right node with its left child (null or not both OK)
+			//then let it take over children and height of the removing node
+			_Node* new_root = *most_right;
+			*most_right = new_root->_child_left;
+			new_root->_child_left = ready_to_release->_child_left;
+			new_root->_child_right = ready_to_release->_child_right;
+			new_root->_height = ready_to_release->_height;
+			*link = new_root;
+
+			//the link below the replaced node belonged to the released node, move it to the new one
+			if (depth > replaced_at + 1) { path[replaced_at + 1] = &(new_root->_child_left); }
+		}
+
+		_retrace(path, depth);
+		return ready_to_release;
+	}
+
+	//hang a detached node into root as a new leaf
+	//if its key is already there nothing changes and the node holding the key is returned
+	_Node* _link_node(_Node*& root, _Node* node) const
+	{
+		_path_type path;
+		std::size_t depth = 0;
+		_Node** link = &root;
+		const key_type& key = node->_key;
+
+		while (*link)
+		{
+			auto order = _compare(key, (*link)->_key);
+			if (order == 0) { return *link; }
+
+			path[depth++] = link;
+			if (order > 0) { link = &((*link)->_child_right); }
+			else { link = &((*link)->_child_left); }
+		}
+
+		node->_reset_leaf();
+		*link = node;
+		_retrace(path, depth);
+		return nullptr;
+	}
+
+	//join and split, all of them only relink nodes and never allocate
+	//every key in left is less than the key of middle, every key in right is greater
+
+	struct _split_result
+	{
+		_Node* left;
+		_Node* middle;
+		_Node* right;
+	};
+
+	_Node* _join(_Node* left, _Node* middle, _Node* right) const
+	{
+		int left_height = _get_height(left);
+		int right_height = _get_height(right);
+		if (left_height > right_height + 1) { return _join_right(left, middle, right); }
+		if (right_height > left_height + 1) { return _join_left(left, middle, right); }
+
+		middle->_child_left = left;
+		middle->_child_right = right;
+		middle->_update_height();
+		return middle;
+	}
+
+	//left is the taller one, go down its right spine to the first subtree at most one level taller than right
+	//hanging middle there makes that subtree one level taller, then it is fixed up like an insertion
+	_Node* _join_right(_Node* left, _Node* middle, _Node* right) const
+	{
+		int right_height = _get_height(right);
+		_path_type path;
+		std::size_t depth = 0;
+		_Node** link = &left;
+		while (_get_height(*link) > right_height + 1)
+		{
+			path[depth++] = link;
+			link = &((*link)->_child_right);
+		}
+
+		middle->_child_left = *link;
+		middle->_child_right = right;
+		middle->_update_height();
+		*link = middle;
+		_retrace(path, depth);
+		return left;
+	}
+
+	//mirror of _join_right
+	_Node* _join_left(_Node* left, _Node* middle, _Node* right) const
+	{
+		int left_height = _get_height(left);
+		_path_type path;
+		std::size_t depth = 0;
+		_Node** link = &right;
+		while (_get_height(*link) > left_height + 1)
+		{
+			path[depth++] = link;
+			link = &((*link)->_child_left);
+		}
+
+		middle->_child_left = left;
+		middle->_child_right = *link;
+		middle->_update_height();
+		*link = middle;
+		_retrace(path, depth);
+		return right;
+	}
+
+	//join without a middle node, the most right node of left is taken out to be one
+	_Node* _join_two(_Node* left, _Node* right) const
+	{
+		if (!left) { return right; }
+		if (!right) { return left; }
+
+		_path_type path;
+		std::size_t depth = 0;
+		_Node** link = &left;
+		while ((*link)->_child_right)
+		{
+			path[depth++] = link;
+			link = &((*link)->_child_right);
+		}
+		_Node* middle = *link;
+		*link = middle->_child_left;
+		_retrace(path, depth);
+		return _join(left, middle, right);
+	}
+
+	//cut root into keys less than key and keys greater than key
+	//the node holding key, if any, comes back detached as middle
+	_split_result _split(_Node* root, const key_type& key) const
+	{
+		if (!root) { return { nullptr, nullptr, nullptr }; }
+
+		_Node* left = root->_child_left;
+		_Node* right = root->_child_right;
+		auto order = _compare(key, root->_key);
+		if (order == 0)
+		{
+			root->_reset_leaf();
+			return { left, root, right };
+		}
+
+		if (order > 0)
+		{
+			_split_result result = _split(right, key);
+			result.left = _join(left, root, result.left);
+			return result;
+		}
+		_split_result result = _split(left, key);
+		result.right = _join(result.right, root, right);
+		return result;
+	}
+
+	//parallel bulk operations fork on the two halves of a subtree until forks_left runs out
+	//nothing is allocated or released while forked, dropped nodes are collected and released afterwards
+
+	//two levels of forks per doubling of threads, AVL halves are not always the same size
+	static int _fork_depth(const parallel_policy& policy)
+	{
+		if (policy.thread_count <= 1) { return 0; }
+		return static_cast<int>(std::bit_width(policy.thread_count - 1)) + 1;
+	}
+
+	//a thread costs more than handling a few hundred nodes, so small subtrees stay on the current thread
+	static constexpr int _fork_min_height = 12;
+
+	static bool _is_worth_fork(int forks_left, _Node* root, _Node* other_root = nullptr)
+	{
+		return forks_left > 0 && std::max(_get_height(root), _get_height(other_root)) >= _fork_min_height;
+	}
+
+	static void _fork_join(bool is_fork, auto&& left_task, auto&& right_task)
+	{
+		if (!is_fork)
+		{
+			left_task();
+			right_task();
+			return;
+		}
+
+		auto left_done = std::async(std::launch::async, left_task);
+		right_task();
+		left_done.get();
+	}
+
+	//nodes waiting to be released, chained through _child_left
+	struct _node_list
+	{
+		_Node* head = nullptr;
+		_Node* tail = nullptr;
+
+		void push(_Node* node)
+		{
+			node->_child_left = head;
+			head = node;
+			if (!tail) { tail = node; }
+		}
+
+		void splice(_node_list& other)
+		{
+			if (!other.head) { return; }
+			if (tail) { tail->_child_left = other.head; }
+			else { head = other.head; }
+			tail = other.tail;
+			other.head = other.tail = nullptr;
+		}
+	};
+
+	void _release_list(_node_list& list)
+	{
+		while (list.head)
+		{
+			_Node* next = list.head->_child_left;
+			_delete_node(list.head);
+			list.head = next;
+		}
+		list.tail = nullptr;
+	}
+
+	//remove the keys of the sorted unique range [first, last) from root
+	//the range is cut by the key of each node on the way down, so only subtrees holding some of the keys are visited
+	_Node* _erase_sorted_impl(
+		_Node* root, const key_type* first, const key_type* last,
+		_node_list& garbage, std::size_t& erased_count, int forks_left) const
+	{
+		if (!root || first == last) { return root; }
+
+		const key_type* lower = std::lower_bound(first, last, root->_key,
+			[this](const key_type& lhs, const key_type& rhs) { return _less(lhs, rhs); });
+		bool is_erased = lower != last && !_less(root->_key, *lower);
+		const key_type* upper = is_erased ? lower + 1 : lower;
+
+		bool is_fork = _is_worth_fork(forks_left, root);
+		_Node* left = root->_child_left;
+		_Node* right = root->_child_right;
+		_node_list right_garbage;
+		std::size_t right_erased_count = 0;
+		_fork_join(is_fork,
+			[&] { left = _erase_sorted_impl(left, first, lower, garbage, erased_count, forks_left - 1); },
+			[&] { right = _erase_sorted_impl(right, upper, last, right_garbage, right_erased_count, forks_left - 1); });
+		garbage.splice(right_garbage);
+		erased_count += right_erased_count;
+
+		if (is_erased)
+		{
+			++erased_count;
+			garbage.push(root);
+			return _join_two(left, right);
+		}
+		return _join(left, root, right);
+	}
+
+	//keep the nodes for which pred(key, value) is true, pred is called from several threads when forked
+	_Node* _filter_impl(
+		_Node* root, auto& pred,
+		_node_list& garbage, std::size_t& removed_count, int forks_left) const
+	{
+		if (!root) { return nullptr; }
+
+		bool is_fork = _is_worth_fork(forks_left, root);
+		_Node* left = root->_child_left;
+		_Node* right = root->_child_right;
+		_node_list right_garbage;
+		std::size_t right_removed_count = 0;
+		_fork_join(is_fork,
+			[&] { left = _filter_impl(left, pred, garbage, removed_count, forks_left - 1); },
+			[&] { right = _filter_impl(right, pred, right_garbage, right_removed_count, forks_left - 1); });
+		garbage.splice(right_garbage);
+		removed_count += right_removed_count;
+
+		const key_type& key = root->_key;
+		if (pred(key, root->_value)) { return _join(left, root, right); }
+
+		++removed_count;
+		garbage.push(root);
+		return _join_two(left, right);
+	}
+
+	//set operations in the style of "Just Join for Parallel Ordered Sets"
+	//other_root is taken apart node by node and root is split by each of its keys
+	//O(m log(n / m + 1)) for trees of size m <= n, plus releasing whatever nodes the result drops
+
+	//below this height (at most 15 nodes) other_root is inserted node by node
+	static constexpr int _union_link_height = 4;
+
+	void _link_all(_Node*& root, _Node* other_root, _Node*& duplicates, std::size_t& duplicate_count) const
+	{
+		if (!other_root) { return; }
+
+		_Node* other_left = other_root->_child_left;
+		_Node* other_right = other_root->_child_right;
+		if (_link_node(root, other_root))
+		{
+			++duplicate_count;
+			_link_node(duplicates, other_root);
+		}
+		_link_all(root, other_left, duplicates, duplicate_count);
+		_link_all(root, other_right, duplicates, duplicate_count);
+	}
+
+	//a key in both trees keeps the node of root, the node of other_root goes to duplicates
+	_Node* _union_impl(
+		_Node* root, _Node* other_root,
+		_Node*& duplicates, std::size_t& duplicate_count, int forks_left = 0) const
+	{
+		if (!root || !other_root)
+		{
+			duplicates = nullptr;
+			return root ? root : other_root;
+		}
+
+		if (_get_height(other_root) <= _union_link_height)
+		{
+			//a small tree is cheaper to insert node by node than to split root by
+			duplicates = nullptr;
+			_link_all(root, other_root, duplicates, duplicate_count);
+			return root;
+		}
+
+		bool is_fork = _is_worth_fork(forks_left, root, other_root);
+		_Node* other_left = other_root->_child_left;
+		_Node* other_right = other_root->_child_right;
+		auto [left, middle, right] = _split(root, other_root->_key);
+
+		_Node* left_duplicates = nullptr;
+		_Node* right_duplicates = nullptr;
+		_Node* new_left = nullptr;
+		_Node* new_right = nullptr;
+		std::size_t right_duplicate_count = 0;
+		_fork_join(is_fork,
+			[&] { new_left = _union_impl(left, other_left, left_duplicates, duplicate_count, forks_left - 1); },
+			[&] { new_right = _union_impl(right, other_right, right_duplicates, right_duplicate_count, forks_left - 1); });
+		duplicate_count += right_duplicate_count;
+
+		if (middle)
+		{
+			++duplicate_count;
+			duplicates = _join(left_duplicates, other_root, right_duplicates);
+			return _join(new_left, middle, new_right);
+		}
+		duplicates = _join_two(left_duplicates, right_duplicates);
+		return _join(new_left, other_root, new_right);
+	}
+
+	//keep the nodes of root whose key is also in other_root, all other nodes are released
+	_Node* _intersect_impl(_Node* root, _Node* other_root, std::size_t& kept_count)
+	{
+		if (!root || !other_root)
+		{
+			_destroy_impl(root);
+			_destroy_impl(other_root);
+			return nullptr;
+		}
+
+		_Node* other_left = other_root->_child_left;
+		_Node* other_right = other_root->_child_right;
+		auto [left, middle, right] = _split(root, other_root->_key);
+		_delete_node(other_root);
+
+		_Node* new_left = _intersect_impl(left, other_left, kept_count);
+		_Node* new_right = _intersect_impl(right, other_right, kept_count);
+		if (middle)
+		{
+			++kept_count;
+			return _join(new_left, middle, new_right);
+		}
+		return _join_two(new_left, new_right);
+	}
+
+	//release the nodes of root whose key is in other_root, all nodes of other_root are released too
+	_Node* _subtract_impl(_Node* root, _Node* other_root, std::size_t& removed_count)
+	{
+		if (!root || !other_root)
+		{
+			_destroy_impl(other_root);
+			return root;
+		}
+
+		_Node* other_left = other_root->_child_left;
+		_Node* other_right = other_root->_child_right;
+		auto [left, middle, right] = _split(root, other_root->_key);
+		_delete_node(other_root);
+		if (middle)
+		{
+			++removed_count;
+			_delete_node(middle);
+		}
+
+		_Node* new_left = _subtract_impl(left, other_left, removed_count);
+		_Node* new_right = _subtract_impl(right, other_right, removed_count);
+		return _join_two(new_left, new_right);
+	}
+
+	static std::size_t _count_impl(_Node* root)
+	{
+		if constexpr (_is_order_statistic) { return _get_count(root); }
+		if (!root) { return 0; }
+		return 1 + _count_impl(root->_child_left) + _count_impl(root->_child_right);
+	}
+
+	//move a whole subtree into the resource of another tree, keeping its shape
+	static _Node* _rehome(_Node* root, AVL& from, AVL& to)
+	{
+		if (!root) { return nullptr; }
+
+		_Node* left = root->_child_left;
+		_Node* right = root->_child_right;
+		_Node* node = to._new_node(std::move(root->_key), std::move(root->_value));
+		node->_height = root->_height;
+		node->_count = root->_count;
+		node->_aggregate = root->_aggregate;
+		from._delete_node(root);
+		node->_child_left = _rehome(left, from, to);
+		node->_child_right = _rehome(right, from, to);
+		return node;
+	}
+
+	//take all nodes of other, which is left empty
+	//nodes are only relinked when both trees share a resource, otherwise they are moved over one by one first
+	_Node* _adopt(AVL& other)
+	{
+		_Node* root = std::exchange(other._head, nullptr);
+		other._size = 0;
+		if (_alloc == other._alloc) { return root; }
+		return _rehome(root, other, *this);
+	}
+
+	//only set when the tree was built without a resource, declared before _alloc so it outlives the nodes
+	//shared with trees split off from this one, their nodes live in the same pool
+	std::shared_ptr<node_pool_type> _own_pool;
+	allocator_type _alloc;
+	_Node* _head;
+	std::size_t _size;
+	//trees that exchange nodes (join, split, merge, set operations) are expected to order keys the same way
+	AVL_NO_UNIQUE_ADDRESS _Compare _comp;
+
+#ifdef AVL_STATS
+	//same fields as avl_stats, kept by the tree itself and never moved along with its nodes
+	struct _stat_counters
+	{
+		std::atomic<std::uint64_t> lookups{};
+		std::atomic<std::uint64_t> lookup_comparisons{};
+		std::array<std::atomic<std::uint64_t>, avl_stats::depth_buckets> lookup_depths{};
+		std::atomic<std::uint64_t> single_rotations{};
+		std::atomic<std::uint64_t> double_rotations{};
+		std::atomic<std::uint64_t> retraces{};
+		std::atomic<std::uint64_t> retrace_steps{};
+		std::atomic<std::uint64_t> node_allocations{};
+		std::atomic<std::uint64_t> node_frees{};
+		std::atomic<std::uint64_t> overwrites{};
+	};
+	//rebalancing in const members (split, set operations) is counted too
+	mutable _stat_counters _stats;
+#endif
+
+	void _count_lookup([[maybe_unused]] std::size_t depth) const
+	{
+		AVL_STAT_ADD(lookups, 1);
+		AVL_STAT_ADD(lookup_comparisons, depth);
+		AVL_STAT_ADD(lookup_depths[std::min(depth, avl_stats::depth_buckets - 1)], 1);
+	}
+
+public:
+	//bidirectional iterator over keys in order
+	//it keeps the path from the root to the current node, so stepping is amortized O(1) without parent links
+	//any insert or erase invalidates every iterator of the tree
+	template<bool _is_const>
+	class _iterator
+	{
+		friend class AVL;
+		template<bool>
+		friend class _iterator;
+
+	public:
+		using iterator_category = std::bidirectional_iterator_tag;
+		using difference_type = std::ptrdiff_t;
+		using value_type = std::pair<const _KeyTy, _ValTy>;
+		using reference = std::pair<const _KeyTy&, std::conditional_t<_is_const, const _ValTy&, _exposed_value_type&>>;
+
+		//operator-> hands out a pair of references, so it has to live somewhere while it is used
+		struct pointer
+		{
+			reference _ref;
+			const reference* operator->() const { return &_ref; }
+		};
+
+		_iterator() = default;
+
+		_iterator(const _iterator& other) : _root(other._root), _depth(other._depth)
+		{
+			std::copy_n(other._path, _depth, _path);
+		}
+
+		//iterator converts to const_iterator
+		_iterator(const _iterator<false>& other) requires _is_const : _root(other._root), _depth(other._depth)
+		{
+			std::copy_n(other._path, _depth, _path);
+		}
+
+		_iterator& operator=(const _iterator& other)
+		{
+			_root = other._root;
+			_depth = other._depth;
+			std::copy_n(other._path, _depth, _path);
+			return *this;
+		}
+
+		reference operator*() const { return { _current()->_key, _current()->_value }; }
+		pointer operator->() const { return { **this }; }
+		const key_type& key() const { return _current()->_key; }
+		std::tuple_element_t<1, reference> value() const { return _current()->_value; }
+
+		_iterator& operator++()
+		{
+			_Node* node = _current();
+			if (node->_child_right)
+			{
+				_push_most_left(node->_child_right);
+				return *this;
+			}
+
+			//go up until coming from a left child, that parent is the next one
+			--_depth;
+			while (_depth && _path[_depth - 1]->_child_right == node) { node = _path[--_depth]; }
+			return *this;
+		}
+
+		_iterator& operator--()
+		{
+			if (!_depth) //step back from end
+			{
+				_push_most_right(*_root);
+				return *this;
+			}
+
+			_Node* node = _current();
+			if (node->_child_left)
+			{
+				_push_most_right(node->_child_left);
+				return *this;
+			}
+
+			--_depth;
+			while (_depth && _path[_depth - 1]->_child_left == node) { node = _path[--_depth]; }
+			return *this;
+		}
+
+		_iterator operator++(int)
+		{
+			_iterator old = *this;
+			++*this;
+			return old;
+		}
+
+		_iterator operator--(int)
+		{
+			_iterator old = *this;
+			--*this;
+			return old;
+		}
+
+		friend bool operator==(const _iterator& lhs, const _iterator& rhs)
+		{
+			return lhs._current() == rhs._current();
+		}
+
+	private:
+		_Node* _current() const { return _depth ? _path[_depth - 1] : nullptr; }
+
+		void _push_most_left(_Node* node)
+		{
+			while (node)
+			{
+				_path[_depth++] = node;
+				node = node->_child_left;
+			}
+		}
+
+		void _push_most_right(_Node* node)
+		{
+			while (node)
+			{
+				_path[_depth++] = node;
+				node = node->_child_right;
+			}
+		}
+
+		//_head of the tree, where stepping back from end starts
+		_Node* const* _root = nullptr;
+		//empty path is end
+		std::size_t _depth = 0;
+		_Node* _path[_max_depth];
+	};
+
+	using iterator = _iterator<false>;
+	using const_iterator = _iterator<true>;
+
+	//owns one node taken out of a tree by extract, like std::map::node_type
+	//insert puts the node back into a tree as it is, without allocating, when that tree uses the same resource
+	//a handle still holding its node gives it back to the resource it came from
+	//it keeps a pool of the tree's own alive, so the node outlives the tree
+	class node_type
+	{
+		friend class AVL;
+
+	public:
+		using key_type = _KeyTy;
+		using mapped_type = _ValTy;
+		using allocator_type = std::pmr::polymorphic_allocator<>;
+
+		node_type() = default;
+
+		node_type(node_type&& other) noexcept :
+			_node(std::exchange(other._node, nullptr)), _alloc(other._alloc), _pool(std::move(other._pool)) {}
+
+		node_type& operator=(node_type&& other) noexcept
+		{
+			if (this != &other)
+			{
+				_release();
+				_node = std::exchange(other._node, nullptr);
+				std::destroy_at(&_alloc);
+				std::construct_at(&_alloc, other._alloc);
+				_pool = std::move(other._pool);
+			}
+			return *this;
+		}
+
+		~node_type() { _release(); }
+
+		bool empty() const noexcept { return !_node; }
+		explicit operator bool() const noexcept { return _node; }
+		allocator_type get_allocator() const noexcept { return _alloc; }
+
+		//the node is in no tree, so both can be changed, its aggregate is refreshed when it is inserted
+		key_type& key() const { return _node->_key; }
+		mapped_type& mapped() const { return _node->_value; }
+
+	private:
+		node_type(_Node* node, const AVL& tree) : _node(node), _alloc(tree._alloc), _pool(tree._own_pool) {}
+
+		void _release()
+		{
+			if (!_node) { return; }
+			std::pmr::polymorphic_allocator<_Node> alloc{ _alloc };
+			alloc.delete_object(std::exchange(_node, nullptr));
+		}
+
+		_Node* _node = nullptr;
+		allocator_type _alloc;
+		std::shared_ptr<node_pool_type> _pool;
+	};
+
+	//what insert(node_type&&) did, value points to the value now held for the key
+	//when the key was already in the tree nothing changed and node is the handle given back
+	struct insert_return_type
+	{
+		_exposed_value_type* value;
+		bool inserted;
+		node_type node;
+	};
+
+private:
+	//_is_upper false finds the first key not less than key, true the first key greater than key
+	template<typename _It, bool _is_upper>
+	_It _bound_impl(const auto& key) const
+	{
+		_It result;
+		result._root = &_head;
+		std::size_t found_depth = 0;
+		_Node* node = _head;
+		while (node)
+		{
+			result._path[result._depth++] = node;
+			bool is_after = _is_upper ? _less(key, node->_key) : !_less(node->_key, key);
+			if (is_after)
+			{
+				found_depth = result._depth;
+				node = node->_child_left;
+			}
+			else { node = node->_child_right; }
+		}
+		//cut the path back to the last node that was after key, everything above it are its ancestors
+		result._depth = found_depth;
+		return result;
+	}
+
+	template<typename _It>
+	_It _begin_impl() const
+	{
+		_It result;
+		result._root = &_head;
+		result._push_most_left(_head);
+		return result;
+	}
+
+	template<typename _It>
+	_It _end_impl() const
+	{
+		_It result;
+		result._root = &_head;
+		return result;
+	}
+
+	//descend by subtree sizes, the path keeps every ancestor so the iterator can step from there
+	template<typename _It>
+	_It _select_impl(std::size_t index) const requires _is_order_statistic
+	{
+		_It result;
+		result._root = &_head;
+		if (index >= _get_count(_head)) { return result; }
+
+		_Node* node = _head;
+		while (true)
+		{
+			result._path[result._depth++] = node;
+			std::size_t left_count = _get_count(node->_child_left);
+			if (index == left_count) { return result; }
+			if (index < left_count) { node = node->_child_left; }
+			else
+			{
+				index -= left_count + 1;
+				node = node->_child_right;
+			}
+		}
+	}
+
+	//aggregate of the keys not less than low, a subtree on the right of the path is taken whole
+	_aggregate_type _aggregate_from(_Node* root, const key_type& low) const requires _has_aggregate
+	{
+		_aggregate_type result = _Aggregate::identity();
+		while (root)
+		{
+			if (_less(root->_key, low)) { root = root->_child_right; }
+			else
+			{
+				result = _Aggregate::combine(
+					_Aggregate::combine(_Aggregate::lift(root->_key, root->_value), _get_aggregate(root->_child_right)),
+					result);
+				root = root->_child_left;
+			}
+		}
+		return result;
+	}
+
+	//mirror of _aggregate_from, for the keys less than high
+	_aggregate_type _aggregate_below(_Node* root, const key_type& high) const requires _has_aggregate
+	{
+		_aggregate_type result = _Aggregate::identity();
+		while (root)
+		{
+			if (!_less(root->_key, high)) { root = root->_child_left; }
+			else
+			{
+				result = _Aggregate::combine(
+					result,
+					_Aggregate::combine(_get_aggregate(root->_child_left), _Aggregate::lift(root->_key, root->_value)));
+				root = root->_child_right;
+			}
+		}
+		return result;
+	}
+
+	//visit [low, high) in order, subtrees entirely outside the range are skipped
+	void _for_each_in_range_impl(_Node* root, const key_type& low, const key_type& high, auto& func) const
+	{
+		if (!root) { return; }
+		const key_type& key_now = root->_key;
+		if (_less(low, key_now)) { _for_each_in_range_impl(root->_child_left, low, high, func); }
+		if (!_less(key_now, low) && _less(key_now, high)) { func(key_now, root->_value); }
+		if (_less(key_now, high)) { _for_each_in_range_impl(root->_child_right, low, high, func); }
+	}
+
+public:
+	//every tree gets its own node pool unless a resource is given
+	AVL() : AVL(_Compare()) {}
+	explicit AVL(const _Compare& comp) :
+		_own_pool(std::make_shared<node_pool_type>()), _alloc(_own_pool.get()), _head(nullptr), _size(0), _comp(comp) {}
+	//same as std::pmr::map, a memory_resource* converts to the allocator
+	explicit AVL(const allocator_type& alloc) : AVL(_Compare(), alloc) {}
+	AVL(const _Compare& comp, const allocator_type& alloc) : _own_pool(), _alloc(alloc), _head(nullptr), _size(0), _comp(comp) {}
+
+	AVL(const AVL&) = delete;
+	AVL& operator=(const AVL&) = delete;
+
+	//the moved-from tree keeps its share of an own pool, it still allocates from it when it is used again
+	AVL(AVL&& other) noexcept :
+		_own_pool(other._own_pool), _alloc(other._alloc),
+		_head(std::exchange(other._head, nullptr)), _size(std::exchange(other._size, 0)), _comp(other._comp) {}
+
+	AVL& operator=(AVL&& other) noexcept
+	{
+		if (this != &other)
+		{
+			_clear_impl<true>();
+			_head = std::exchange(other._head, nullptr);
+			_size = std::exchange(other._size, 0);
+			//nodes keep living in the resource they were allocated from
+			std::destroy_at(&_alloc);
+			std::construct_at(&_alloc, other._alloc);
+			_own_pool = other._own_pool;
+			_comp = other._comp;
+		}
+		return *this;
+	}
+
+	~AVL() { _clear_impl<true>(); }
+
+	//O(1) for a tree whose nodes need no destructor and live in a monotonic buffer,
+	//otherwise O(n) without recursion, see _clear_impl
+	void clear() { _clear_impl(); }
+
+	std::size_t size() { return _size; }
+	//bytes of the nodes as asked from the resource, without sizeof(AVL) and without memory the keys and values own
+	//what the resource keeps on top of that shows in a CountingResource put in front of it
+	std::size_t memory_usage() const noexcept { return _size * sizeof(_Node); }
+	allocator_type get_allocator() const noexcept { return _alloc; }
+	key_compare key_comp() const { return _comp; }
+
+	//what this tree counted since it was built or since the last reset_stats, all zero without AVL_STATS
+	//counts made by other threads at the same time may or may not be in it
+	avl_stats stats() const
+	{
+		avl_stats result;
+#ifdef AVL_STATS
+		auto load = [](const std::atomic<std::uint64_t>& counter) { return counter.load(std::memory_order_relaxed); };
+		result.lookups = load(_stats.lookups);
+		result.lookup_comparisons = load(_stats.lookup_comparisons);
+		for (std::size_t depth = 0; depth < avl_stats::depth_buckets; ++depth) { result.lookup_depths[depth] = load(_stats.lookup_depths[depth]); }
+		result.single_rotations = load(_stats.single_rotations);
+		result.double_rotations = load(_stats.double_rotations);
+		result.retraces = load(_stats.retraces);
+		result.retrace_steps = load(_stats.retrace_steps);
+		result.node_allocations = load(_stats.node_allocations);
+		result.node_frees = load(_stats.node_frees);
+		result.overwrites = load(_stats.overwrites);
+#endif
+		return result;
+	}
+
+	//no other thread may use the tree meanwhile
+	void reset_stats()
+	{
+#ifdef AVL_STATS
+		std::destroy_at(&_stats);
+		std::construct_at(&_stats);
+#endif
+	}
+
+	[[nodiscard]]
+	std::optional<std::reference_wrapper<_exposed_value_type>> find(const key_type& key)
+	{
+		_Node* result = _find_impl(key);
+		if (result) { return result->_value; }
+		else { return std::nullopt; }
+	}
+
+	template<typename _LookupTy>
+	requires _is_other_lookup<_LookupTy>
+	[[nodiscard]]
+	std::optional<std::reference_wrapper<_exposed_value_type>> find(const _LookupTy& key)
+	{
+		_Node* result = _find_impl(key);
+		if (result) { return result->_value; }
+		else { return std::nullopt; }
+	}
+
+	//out[i] is set to the value of keys[i], or to null when keys[i] is not in the tree
+	//many independent lookups overlap their cache misses, for a large tree it beats calling find in a loop
+	void find_batch(std::span<const key_type> keys, std::span<_exposed_value_type*> out)
+	{
+		_find_batch_impl(keys, out);
+	}
+
+	void find_batch(std::span<const key_type> keys, std::span<const value_type*> out) const
+	{
+		_find_batch_impl(keys, out);
+	}
+
+	//immutable copy in a pointer-free layout, for a tree that is only read from now on, see FrozenTree
+	[[nodiscard]]
+	FrozenTree<key_type, value_type, _Compare> freeze() const
+	{
+		return { begin(), end(), _comp };
+	}
+
+	//write the keys and values as an image file, which open_mapped serves without loading it, see FrozenTree::save
+	void save(const std::filesystem::path& path) const
+		requires std::is_trivially_copyable_v<key_type> && std::is_trivially_copyable_v<value_type>
+	{
+		freeze().save(path);
+	}
+
+	//a read-only snapshot searching an image written by save in place, pages are read in as lookups touch them
+	[[nodiscard]]
+	static FrozenTree<key_type, value_type, _Compare> open_mapped(const std::filesystem::path& path, const _Compare& comp = _Compare())
+		requires std::is_trivially_copyable_v<key_type> && std::is_trivially_copyable_v<value_type>
+	{
+		return FrozenTree<key_type, value_type, _Compare>::open_mapped(path, comp);
+	}
+
+	iterator begin() { return _begin_impl<iterator>(); }
+	iterator end() { return _end_impl<iterator>(); }
+	const_iterator begin() const { return _begin_impl<const_iterator>(); }
+	const_iterator end() const { return _end_impl<const_iterator>(); }
+	const_iterator cbegin() const { return begin(); }
+	const_iterator cend() const { return end(); }
+
+	iterator lower_bound(const key_type& key) { return _bound_impl<iterator, false>(key); }
+	iterator upper_bound(const key_type& key) { return _bound_impl<iterator, true>(key); }
+	const_iterator lower_bound(const key_type& key) const { return _bound_impl<const_iterator, false>(key); }
+	const_iterator upper_bound(const key_type& key) const { return _bound_impl<const_iterator, true>(key); }
+
+	std::pair<iterator, iterator> equal_range(const key_type& key) { return { lower_bound(key), upper_bound(key) }; }
+	std::pair<const_iterator, const_iterator> equal_range(const key_type& key) const { return { lower_bound(key), upper_bound(key) }; }
+
+	template<typename _LookupTy> requires _is_other_lookup<_LookupTy>
+	iterator lower_bound(const _LookupTy& key) { return _bound_impl<iterator, false>(key); }
+	template<typename _LookupTy> requires _is_other_lookup<_LookupTy>
+	iterator upper_bound(const _LookupTy& key) { return _bound_impl<iterator, true>(key); }
+	template<typename _LookupTy> requires _is_other_lookup<_LookupTy>
+	const_iterator lower_bound(const _LookupTy& key) const { return _bound_impl<const_iterator, false>(key); }
+	template<typename _LookupTy> requires _is_other_lookup<_LookupTy>
+	const_iterator upper_bound(const _LookupTy& key) const { return _bound_impl<const_iterator, true>(key); }
+
+	template<typename _LookupTy> requires _is_other_lookup<_LookupTy>
+	std::pair<iterator, iterator> equal_range(const _LookupTy& key) { return { lower_bound(key), upper_bound(key) }; }
+	template<typename _LookupTy> requires _is_other_lookup<_LookupTy>
+	std::pair<const_iterator, const_iterator> equal_range(const _LookupTy& key) const { return { lower_bound(key), upper_bound(key) }; }
+
+	//call func(key, value) for every key in [low, high), in order
+	void for_each_in_range(const key_type& low, const key_type& high, auto&& func)
+	{
+		auto exposed_func = [&func](const key_type& key, _exposed_value_type& value) { func(key, value); };
+		_for_each_in_range_impl(_head, low, high, exposed_func);
+	}
+
+	void for_each_in_range(const key_type& low, const key_type& high, auto&& func) const
+	{
+		auto const_func = [&func](const key_type& key, const value_type& value) { func(key, value); };
+		_for_each_in_range_impl(_head, low, high, const_func);
+	}
+
+	//order statistics, only with _is_order_statistic, all of them O(log n)
+
+	//number of keys less than key
+	std::size_t rank(const key_type& key) const requires _is_order_statistic
+	{
+		std::size_t result = 0;
+		_Node* node = _head;
+		while (node)
+		{
+			auto order = _compare(key, node->_key);
+			if (order == 0) { return result + _get_count(node->_child_left); }
+			if (order > 0)
+			{
+				result += _get_count(node->_child_left) + 1;
+				node = node->_child_right;
+			}
+			else { node = node->_child_left; }
+		}
+		return result;
+	}
+
+	//the index-th smallest key counted from 0, end if there are not that many keys
+	iterator select(std::size_t index) requires _is_order_statistic { return _select_impl<iterator>(index); }
+	const_iterator select(std::size_t index) const requires _is_order_statistic { return _select_impl<const_iterator>(index); }
+
+	//number of keys in [low, high)
+	std::size_t count_range(const key_type& low, const key_type& high) const requires _is_order_statistic
+	{
+		if (!_less(low, high)) { return 0; }
+		return rank(high) - rank(low);
+	}
+
+	//the lower one of the two middle keys when size is even, end when empty
+	iterator median() requires _is_order_statistic { return select(_size ? (_size - 1) / 2 : 0); }
+	const_iterator median() const requires _is_order_statistic { return select(_size ? (_size - 1) / 2 : 0); }
+
+	//aggregate of the whole tree, only with _Aggregate
+	_aggregate_type aggregate() const requires _has_aggregate { return _get_aggregate(_head); }
+
+	//aggregate of the keys in [low, high), O(log n)
+	//below the first node inside the range, its left subtree only has a lower bound and its right one only an upper bound
+	_aggregate_type aggregate(const key_type& low, const key_type& high) const requires _has_aggregate
+	{
+		_Node* node = _head;
+		while (node)
+		{
+			if (_less(node->_key, low)) { node = node->_child_right; }
+			else if (!_less(node->_key, high)) { node = node->_child_left; }
+			else { break; }
+		}
+		if (!node) { return _Aggregate::identity(); }
+
+		return _Aggregate::combine(
+			_Aggregate::combine(_aggregate_from(node->_child_left, low), _Aggregate::lift(node->_key, node->_value)),
+			_aggregate_below(node->_child_right, high));
+	}
+
+	AVL& insert(
+		is_cvref_t_of<key_type> auto&& key,
+		is_cvref_t_of<value_type> auto&& value)
+	{
+		_push_impl<true>(FWD(key), FWD(value));
+		return *this;
+	}
+
+	//the bool is true when key was not in the tree before
+	std::pair<std::reference_wrapper<_exposed_value_type>, bool> insert_or_assign(
+		is_cvref_t_of<key_type> auto&& key,
+		is_cvref_t_of<value_type> auto&& value)
+	{
+		auto [node, is_inserted] = _push_impl<true>(FWD(key), FWD(value));
+		return { node->_value, is_inserted };
+	}
+
+	//insert or assign starting the search at hint instead of at the root
+	//a key close to hint in order costs O(1) amortized comparisons, a hint far away only costs the ascent back up
+	//end or an iterator of another tree is no hint, the search starts at the root
+	//the returned iterator points at key
+	iterator insert(
+		const_iterator hint,
+		is_cvref_t_of<key_type> auto&& key,
+		is_cvref_t_of<value_type> auto&& value)
+	{
+		_path_type path;
+		std::size_t depth;
+		_path_of(hint, path, depth);
+		_push_near<true>(path, depth, FWD(key), FWD(value));
+		return _iterator_of(path, depth);
+	}
+
+	//keeps where the last insert through it happened and starts the next one there, see insert with a hint
+	//made for mostly increasing or clustered keys, appending in order costs about as much as a push_back
+	//like an iterator, it is invalidated by any insert or erase on the tree not done through it
+	class finger
+	{
+	public:
+		explicit finger(AVL& tree) : _tree(&tree) { _path[0] = &(tree._head); }
+
+		//the bool is true when key was not in the tree before
+		bool insert_or_assign(
+			is_cvref_t_of<key_type> auto&& key,
+			is_cvref_t_of<value_type> auto&& value)
+		{
+			return _tree->template _push_near<true>(_path, _depth, FWD(key), FWD(value)).second;
+		}
+
+		finger& insert(
+			is_cvref_t_of<key_type> auto&& key,
+			is_cvref_t_of<value_type> auto&& value)
+		{
+			insert_or_assign(FWD(key), FWD(value));
+			return *this;
+		}
+
+		//the last key inserted through it, end before the first one
+		iterator position() const { return _tree->_iterator_of(_path, _depth); }
+
+	private:
+		AVL* _tree;
+		//the links leading to the last key inserted, kept as _push_near wants them
+		_path_type _path;
+		std::size_t _depth = 0;
+	};
+
+	//value is constructed from args only when key is not in the tree yet
+	std::pair<std::reference_wrapper<_exposed_value_type>, bool> try_emplace(
+		is_cvref_t_of<key_type> auto&& key,
+		auto&&... args)
+	{
+		auto [node, is_inserted] = _push_impl<false>(FWD(key), FWD(args)...);
+		return { node->_value, is_inserted };
+	}
+
+	//replace the content with [first, last), which must hold pair-like elements with strictly increasing keys
+	//O(n), with the default node pool all nodes come from one contiguous allocation
+	//legacy forward iterator category, so move_iterator over a vector is accepted too
+	template<std::input_iterator _It>
+	requires std::derived_from<typename std::iterator_traits<_It>::iterator_category, std::forward_iterator_tag>
+	AVL& assign_sorted(_It first, _It last)
+	{
+		_clear_impl();
+
+		std::size_t count = static_cast<std::size_t>(std::distance(first, last));
+		if (count == 0) { return *this; }
+
+		if (auto pool = dynamic_cast<node_pool_type*>(_alloc.resource()))
+		{
+			static_assert(node_pool_type::block_size() == sizeof(_Node));
+			_Node* nodes = static_cast<_Node*>(pool->allocate_contiguous(count));
+			std::size_t constructed = 0;
+			try
+			{
+				for (; first != last; ++first, ++constructed)
+				{
+					auto&& element = *first;
+					std::construct_at(nodes + constructed, std::get<0>(FWD(element)), std::get<1>(FWD(element)));
+				}
+			}
+			catch (...)
+			{
+				std::destroy_n(nodes, constructed);
+				for (std::size_t index = 0; index < count; ++index) { pool->deallocate(nodes + index); }
+				throw;
+			}
+			_head = _link_sorted([nodes](std::size_t index) { return nodes + index; }, 0, count);
+		}
+		else
+		{
+			std::vector<_Node*> nodes;
+			nodes.reserve(count);
+			try
+			{
+				for (; first != last; ++first)
+				{
+					auto&& element = *first;
+					nodes.push_back(_new_node(std::get<0>(FWD(element)), std::get<1>(FWD(element))));
+				}
+			}
+			catch (...)
+			{
+				for (_Node* node : nodes) { _delete_node(node); }
+				throw;
+			}
+			_head = _link_sorted([&nodes](std::size_t index) { return nodes[index]; }, 0, count);
+		}
+
+		_size = count;
+		return *this;
+	}
+
+	//same as assign_sorted but for input in any order, sorts it and drops duplicate keys first
+	//the last value given for a key wins, like inserting the elements one by one would do
+	template<std::input_iterator _It>
+	AVL& assign(_It first, _It last)
+	{
+		auto elements = _sort_unique(first, last);
+		return assign_sorted(std::make_move_iterator(elements.begin()), std::make_move_iterator(elements.end()));
+	}
+
+	AVL& erase(is_cvref_t_of<key_type> auto&& key)
+	{
+		_remove_impl(key);
+		return *this;
+	}
+
+	//take the entry of key out of the tree without freeing its node, an empty handle when key is not in the tree
+	[[nodiscard]]
+	node_type extract(const key_type& key)
+	{
+		return { _unlink_impl(key), *this };
+	}
+
+	template<typename _LookupTy>
+	requires _is_other_lookup<_LookupTy>
+	[[nodiscard]]
+	node_type extract(const _LookupTy& key)
+	{
+		return { _unlink_impl(key), *this };
+	}
+
+	//link the node of handle into the tree, if its key is not there yet
+	//a node from another resource is moved into a new node of this tree's resource first, like join does
+	insert_return_type insert(node_type&& handle)
+	{
+		if (handle.empty()) { return { nullptr, false, {} }; }
+		if (handle._alloc != _alloc)
+		{
+			//a handle given back must still hold its own node
+			if (_Node* existing = _find_impl(handle.key())) { return { &(existing->_value), false, std::move(handle) }; }
+			_Node* node = _new_node(std::move(handle._node->_key), std::move(handle._node->_value));
+			handle._release();
+			handle = node_type(node, *this);
+		}
+
+		if (_Node* existing = _link_node(_head, handle._node)) { return { &(existing->_value), false, std::move(handle) }; }
+		++_size;
+		_Node* node = std::exchange(handle._node, nullptr);
+		return { &(node->_value), true, {} };
+	}
+
+	template<typename _LookupTy>
+	requires _is_other_lookup<_LookupTy>
+	AVL& erase(const _LookupTy& key)
+	{
+		_remove_impl(key);
+		return *this;
+	}
+
+	//append right, every key of *this must be less than key and every key of right greater than key
+	AVL& join(
+		is_cvref_t_of<key_type> auto&& key,
+		is_cvref_t_of<value_type> auto&& value,
+		AVL&& right)
+	{
+		std::size_t right_size = right._size;
+		_Node* right_root = _adopt(right);
+		_Node* middle = _new_node(FWD(key), FWD(value));
+		_head = _join(_head, middle, right_root);
+		_size += right_size + 1;
+		return *this;
+	}
+
+	//append right, every key of *this must be less than every key of right
+	AVL& join(AVL&& right)
+	{
+		if (&right == this) { return *this; }
+		std::size_t right_size = right._size;
+		_Node* right_root = _adopt(right);
+		_head = _join_two(_head, right_root);
+		_size += right_size;
+		return *this;
+	}
+
+	//keys not less than key move to the returned tree, which shares the resource of *this
+	//relinking the nodes is O(log n), so is the whole split with _is_order_statistic
+	//without it the sizes of the two halves are not kept anywhere, the smaller half is counted,
+	//which makes split O(n) in the worst case, and join / merge do not have that cost
+	[[nodiscard]]
+	AVL split(const key_type& key)
+	{
+		auto [left, middle, right] = _split(_head, key);
+		if (middle) { right = _join(nullptr, middle, right); }
+
+		AVL result(_comp, _alloc);
+		result._own_pool = _own_pool;
+		result._head = right;
+		_head = left;
+
+		if constexpr (_is_order_statistic)
+		{
+			result._size = _get_count(right);
+			_size -= result._size;
+		}
+		else if (_get_height(right) <= _get_height(left))
+		{
+			result._size = _count_impl(right);
+			_size -= result._size;
+		}
+		else
+		{
+			std::size_t left_size = _count_impl(left);
+			result._size = _size - left_size;
+			_size = left_size;
+		}
+		return result;
+	}
+
+	//like std::map::merge, keys not in *this move over from source, the others stay in source
+	//with a shared resource no node is allocated or copied
+	AVL& merge(AVL& source, const parallel_policy& policy = {})
+	{
+		if (&source == this) { return *this; }
+
+		bool is_same_resource = _alloc == source._alloc;
+		std::size_t source_size = source._size;
+		_Node* source_root = _adopt(source);
+
+		_Node* duplicates = nullptr;
+		std::size_t duplicate_count = 0;
+		_head = _union_impl(_head, source_root, duplicates, duplicate_count, _fork_depth(policy));
+		_size += source_size - duplicate_count;
+
+		source._head = is_same_resource ? duplicates : _rehome(duplicates, *this, source);
+		source._size = duplicate_count;
+		return *this;
+	}
+
+	//insert or assign every pair-like element of [first, last), the last value given for a key wins
+	//the batch is built into a tree first, then united with *this
+	template<std::input_iterator _It>
+	AVL& insert_bulk(_It first, _It last, const parallel_policy& policy = {})
+	{
+		AVL batch(_comp, _alloc);
+		batch.assign(first, last);
+		std::size_t batch_size = batch._size;
+		_Node* batch_root = std::exchange(batch._head, nullptr);
+		batch._size = 0;
+
+		//the batch goes first so its nodes win, the old nodes of the same keys come back as duplicates
+		_Node* duplicates = nullptr;
+		std::size_t duplicate_count = 0;
+		_head = _union_impl(batch_root, _head, duplicates, duplicate_count, _fork_depth(policy));
+		_size += batch_size - duplicate_count;
+		_destroy_impl(duplicates);
+		return *this;
+	}
+
+	//erase every key in [first, last)
+	template<std::input_iterator _It>
+	AVL& erase_bulk(_It first, _It last, const parallel_policy& policy = {})
+	{
+		std::vector<key_type> keys(first, last);
+		auto less = [this](const key_type& lhs, const key_type& rhs) { return _less(lhs, rhs); };
+		std::sort(keys.begin(), keys.end(), less);
+		keys.erase(std::unique(keys.begin(), keys.end(),
+			[&less](const key_type& lhs, const key_type& rhs) { return !less(lhs, rhs); }), keys.end());
+
+		_node_list garbage;
+		std::size_t erased_count = 0;
+		_head = _erase_sorted_impl(_head, keys.data(), keys.data() + keys.size(), garbage, erased_count, _fork_depth(policy));
+		_size -= erased_count;
+		_release_list(garbage);
+		return *this;
+	}
+
+	//keep only the entries for which pred(key, value) returns true
+	//with more than one thread pred is called concurrently and must not throw
+	AVL& filter(auto&& pred, const parallel_policy& policy = {})
+	{
+		_node_list garbage;
+		std::size_t removed_count = 0;
+		_head = _filter_impl(_head, pred, garbage, removed_count, _fork_depth(policy));
+		_size -= removed_count;
+		_release_list(garbage);
+		return *this;
+	}
+
+	//keep only keys that are also in other, other is consumed
+	AVL& intersect(AVL&& other)
+	{
+		if (&other == this) { return *this; }
+
+		_Node* other_root = _adopt(other);
+		std::size_t kept_count = 0;
+		_head = _intersect_impl(_head, other_root, kept_count);
+		_size = kept_count;
+		return *this;
+	}
+
+	//drop every key that is in other, other is consumed
+	AVL& subtract(AVL&& other)
+	{
+		if (&other == this)
+		{
+			_clear_impl();
+			return *this;
+		}
+
+		_Node* other_root = _adopt(other);
+		std::size_t removed_count = 0;
+		_head = _subtract_impl(_head, other_root, removed_count);
+		_size -= removed_count;
+		return *this;
+	}
+
+	//DEBUG
+	void DFS_impl(_Node* root)
+	{
+		if (root == nullptr) return;
+		DFS_impl(root->_child_left);
+		DFS_impl(root->_child_right);
+		//check subtree size, before _update_height quietly fixes it
+		if constexpr (_is_order_statistic) { assert(root->_count == 1 + _get_count(root->_child_left) + _get_count(root->_child_right)); }
+		if constexpr (_has_aggregate)
+		{
+			auto aggregate = root->_aggregate;
+			root->_update_augment();
+			assert(aggregate == root->_aggregate);
+		}
+		//check height
+		assert(root->_update_height() == is_height_updated::HEIGHT_UPDATE_NO_NEED);
+	}
+
+	//DEBUG
+	void DFS_debug_check()
+	{
+		DFS_impl(this->_head);
+	}
+
+	void another_DFS_impl(_Node* root, long long depth)
+	{
+		static long long former_depth = -1;
+		if (root == nullptr)
+		{
+			if (former_depth == -1)
+			{
+				[[unlikely]];
+				former_depth = depth;
+			}
+			else
+			{
+				auto diff = depth - former_depth;
+				assert(diff >= -1 && diff <= 1);
+				former_depth = depth;
+			}
+			return;
+		}
+		another_DFS_impl(root->_child_left, depth + 1);
+		another_DFS_impl(root->_child_right, depth + 1);
+	}
+
+	//DEBUG
+	void yet_another_DFS_debug_check()
+	{
+		std::cout.sync_with_stdio(false);
+		another_DFS_impl(_head, 1);
+	}
+};
+
+#undef FWD
+#undef AVL_NO_UNIQUE_ADDRESS
+#undef AVL_PREFETCH
+#undef AVL_STAT_ADD
@@ -0,0 +1,524 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <array>
+#include <functional>
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <bit>
+#include <ostream>
+#include <iomanip>
+#include <utility>
+#include <concepts>
+#include <memory_resource>
+#include "alloc.h"
+
+//latencies in nanoseconds, kept as counts per bucket so a run of any length takes the same memory
+//each power of two is cut into 16 buckets, a percentile is exact to within 1/16 of its value
+class LatencyHistogram
+{
+public:
+	void record(std::uint64_t ns)
+	{
+		++_counts[_bucket_of(ns)];
+		++_total;
+		_max = std::max(_max, ns);
+	}
+
+	void merge(const LatencyHistogram& other)
+	{
+		for (std::size_t index = 0; index < _bucket_count; ++index) { _counts[index] += other._counts[index]; }
+		_total += other._total;
+		_max = std::max(_max, other._max);
+	}
+
+	std::uint64_t count() const noexcept { return _total; }
+	std::uint64_t max() const noexcept { return _max; }
+
+	//upper end of the bucket holding the q-th fraction of all samples, 0 when empty
+	std::uint64_t percentile(double q) const
+	{
+		if (_total == 0) { return 0; }
+		std::uint64_t rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(std::ceil(q * static_cast<double>(_total))));
+		std::uint64_t seen = 0;
+		for (std::size_t index = 0; index < _bucket_count; ++index)
+		{
+			seen += _counts[index];
+			if (seen >= rank) { return std::min(_max, _bucket_last(index)); }
+		}
+		return _max;
+	}
+
+private:
+	static constexpr std::size_t _sub_bits = 4;
+	static constexpr std::size_t _sub_count = std::size_t{ 1 } << _sub_bits;
+	static constexpr std::size_t _bucket_count = (64 - _sub_bits + 1) * _sub_count;
+
+	//values below _sub_count have a bucket each, above that the top _sub_bits + 1 bits pick the bucket
+	static std::size_t _bucket_of(std::uint64_t ns)
+	{
+		if (ns < _sub_count) { return static_cast<std::size_t>(ns); }
+		std::size_t shift = static_cast<std::size_t>(std::bit_width(ns)) - 1 - _sub_bits;
+		return (shift + 1) * _sub_count + static_cast<std::size_t>((ns >> shift) & (_sub_count - 1));
+	}
+
+	static std::uint64_t _bucket_last(std::size_t index)
+	{
+		if (index < _sub_count) { return index; }
+		std::size_t shift = index / _sub_count - 1;
+		std::uint64_t first = (_sub_count + index % _sub_count) << shift;
+		return first + ((std::uint64_t{ 1 } << shift) - 1);
+	}
+
+	std::array<std::uint64_t, _bucket_count> _counts{};
+	std::uint64_t _total = 0;
+	std::uint64_t _max = 0;
+};
+
+//ranks 0 .. n - 1 with probability proportional to 1 / (rank + 1)^theta
+//the generator of "Quickly Generating Billion-Record Synthetic Databases" (Gray et al.), as used by YCSB
+class ZipfGenerator
+{
+public:
+	explicit ZipfGenerator(std::size_t n, double theta = 0.99) :
+		_n(std::max<std::size_t>(1, n)), _theta(theta), _alpha(1 / (1 - theta)), _zeta_n(_zeta(_n, theta))
+	{
+		double zeta_2 = _zeta(2, theta);
+		_eta = (1 - std::pow(2.0 / static_cast<double>(_n), 1 - theta)) / (1 - zeta_2 / _zeta_n);
+	}
+
+	std::size_t operator()(std::mt19937_64& engine)
+	{
+		double u = std::uniform_real_distribution<double>(0, 1)(engine);
+		double uz = u * _zeta_n;
+		if (uz < 1) { return 0; }
+		if (uz < 1 + std::pow(0.5, _theta)) { return std::min<std::size_t>(1, _n - 1); }
+		auto rank = static_cast<std::size_t>(static_cast<double>(_n) * std::pow(_eta * u - _eta + 1, _alpha));
+		return std::min(rank, _n - 1);
+	}
+
+private:
+	static double _zeta(std::size_t n, double theta)
+	{
+		double sum = 0;
+		for (std::size_t rank = 1; rank <= n; ++rank) { sum += 1 / std::pow(static_cast<double>(rank), theta); }
+		return sum;
+	}
+
+	std::size_t _n;
+	double _theta;
+	double _alpha;
+	double _zeta_n;
+	double _eta = 0;
+};
+
+//keys of one run, every container of the suite gets the same ones
+//insert_keys are distinct, lookup_keys are all inserted, miss_keys are never inserted
+//a churn workload inserts insert_keys untimed first, then step i erases insert_keys[i] and inserts churn_keys[i]
+struct BenchmarkWorkload
+{
+	std::string name;
+	std::vector<int> insert_keys;
+	std::vector<int> lookup_keys;
+	std::vector<int> miss_keys;
+	std::vector<int> erase_keys;
+	std::vector<int> churn_keys;
+
+	static constexpr const char* names[] = { "sequential", "reverse", "uniform", "zipf", "clustered", "churn" };
+
+	//inserted keys are even, so key + 1 is a miss, and spread out so that up to 100M of them fit in an int
+	static BenchmarkWorkload make(const std::string& name, std::size_t size, std::uint64_t seed)
+	{
+		std::mt19937_64 engine{ seed };
+		BenchmarkWorkload workload;
+		workload.name = name;
+		auto& keys = workload.insert_keys;
+		keys.resize(size);
+		std::iota(keys.begin(), keys.end(), 0);
+		for (int& key : keys) { key *= 16; }
+
+		if (name == "sequential")
+		{
+			workload.lookup_keys = keys;
+			workload.erase_keys = keys;
+		}
+		else if (name == "reverse")
+		{
+			std::reverse(keys.begin(), keys.end());
+			workload.lookup_keys = keys;
+			workload.erase_keys = keys;
+		}
+		else if (name == "clustered")
+		{
+			//64 dense runs of keys at random places, inserted in random order
+			constexpr std::size_t cluster_count = 64;
+			std::size_t cluster_size = size / cluster_count + 1;
+			std::size_t slot = (std::size_t{ 1 } << 31) / cluster_count;
+			std::vector<int> starts;
+			for (std::size_t cluster = 0; cluster < cluster_count; ++cluster)
+			{
+				std::size_t slack = slot - 2 * cluster_size;
+				std::size_t offset = std::uniform_int_distribution<std::size_t>(0, slack / 2)(engine) * 2;
+				starts.push_back(static_cast<int>(cluster * slot + offset));
+			}
+			for (std::size_t index = 0; index < size; ++index)
+			{
+				keys[index] = starts[index % cluster_count] + static_cast<int>(2 * (index / cluster_count));
+			}
+			std::shuffle(keys.begin(), keys.end(), engine);
+			workload._uniform_lookups(engine);
+		}
+		else
+		{
+			std::shuffle(keys.begin(), keys.end(), engine);
+			if (name == "zipf")
+			{
+				//hot keys are scattered over the whole tree, not bunched at one end
+				ZipfGenerator zipf{ size };
+				workload.lookup_keys.reserve(size);
+				for (std::size_t index = 0; index < size; ++index) { workload.lookup_keys.push_back(keys[zipf(engine)]); }
+				workload.erase_keys = keys;
+			}
+			else { workload._uniform_lookups(engine); }
+
+			if (name == "churn")
+			{
+				//fresh keys come from the same range as the first ones, interleaved with them
+				workload.churn_keys.resize(size);
+				for (std::size_t index = 0; index < size; ++index) { workload.churn_keys[index] = keys[index] + 8; }
+				std::shuffle(workload.churn_keys.begin(), workload.churn_keys.end(), engine);
+			}
+		}
+
+		workload.miss_keys.reserve(size);
+		for (int key : workload.lookup_keys) { workload.miss_keys.push_back(key + 1); }
+		return workload;
+	}
+
+private:
+	void _uniform_lookups(std::mt19937_64& engine)
+	{
+		std::uniform_int_distribution<std::size_t> pick(0, insert_keys.size() - 1);
+		lookup_keys.reserve(insert_keys.size());
+		for (std::size_t index = 0; index < insert_keys.size(); ++index) { lookup_keys.push_back(insert_keys[pick(engine)]); }
+		erase_keys = insert_keys;
+		std::shuffle(erase_keys.begin(), erase_keys.end(), engine);
+	}
+};
+
+//what the suite calls on a container, whatever its own spelling of insert, find and erase is
+template<typename _Map>
+void benchmark_insert(_Map& map, int key)
+{
+	map.insert_or_assign(key, static_cast<double>(key));
+}
+
+template<typename _Map>
+bool benchmark_find(_Map& map, int key)
+{
+	if constexpr (requires { map.find(key) != map.end(); }) { return map.find(key) != map.end(); }
+	else if constexpr (requires { map.get_snapshot(); }) { return static_cast<bool>(map.get_snapshot().find(key)); }
+	else { return static_cast<bool>(map.find(key)); }
+}
+
+template<typename _Map>
+void benchmark_erase(_Map& map, int key)
+{
+	map.erase(key);
+}
+
+struct BenchmarkConfig
+{
+	std::vector<std::size_t> sizes{ 1000, 10000, 100000, 1000000 };
+	std::vector<std::string> workloads{ std::begin(BenchmarkWorkload::names), std::end(BenchmarkWorkload::names) };
+	//runs thrown away before measuring, to warm caches, the allocator and the branch predictors
+	std::size_t warmup = 1;
+	std::size_t repetitions = 3;
+	std::uint64_t seed = 42;
+};
+
+//one row of the report
+struct BenchmarkResult
+{
+	std::string container;
+	std::string workload;
+	std::size_t size = 0;
+	std::string phase;
+	//from runs timing the whole phase at once, so no clock call is counted in
+	double ns_per_op_median = 0;
+	double ns_per_op_min = 0;
+	//from runs timing every operation, with the cost of reading the clock taken off
+	std::uint64_t p50 = 0;
+	std::uint64_t p99 = 0;
+	std::uint64_t p999 = 0;
+	std::uint64_t max = 0;
+	//from one more run, untimed, what the container holds once the phase is over
+	//taken from a CountingResource when the container can be built on one, else from its memory_usage()
+	//all 0 when it can be neither, and peak, allocations and fragmentation are only known from a resource
+	double bytes_per_element = 0;
+	std::size_t peak_bytes = 0;
+	std::size_t allocations = 0;
+	double fragmentation = 0;
+};
+
+//every container added runs every workload at every size
+//each repetition runs twice on a new container: once timing whole phases for throughput, once timing every operation
+//so that the clock calls of the latency run do not show up in the throughput
+class BenchmarkSuite
+{
+public:
+	explicit BenchmarkSuite(BenchmarkConfig config) : _config(std::move(config)), _clock_cost(_measure_clock_cost()) {}
+
+	//_Map must be default constructible and take int keys and double values
+	template<typename _Map>
+	BenchmarkSuite& add(std::string name)
+	{
+		_runners.emplace_back(std::move(name), [this](const std::string& container, const BenchmarkWorkload& workload) {
+			_run<_Map>(container, workload);
+		});
+		return *this;
+	}
+
+	//progress goes to log, one line per container and workload
+	void run(std::ostream& log)
+	{
+		for (std::size_t size : _config.sizes)
+		{
+			for (const auto& workload_name : _config.workloads)
+			{
+				BenchmarkWorkload workload = BenchmarkWorkload::make(workload_name, size, _config.seed);
+				for (auto& [name, runner] : _runners)
+				{
+					log << name << ", " << workload_name << ", " << size << std::endl;
+					runner(name, workload);
+				}
+			}
+		}
+	}
+
+	const std::vector<BenchmarkResult>& results() const noexcept { return _results; }
+
+	void write_csv(std::ostream& out) const
+	{
+		out << "container,workload,size,phase,ns_per_op_median,ns_per_op_min,p50_ns,p99_ns,p999_ns,max_ns,"
+			"bytes_per_element,peak_bytes,allocations,fragmentation\n";
+		for (const auto& result : _results)
+		{
+			out << '"' << result.container << "\"," << result.workload << ',' << result.size << ',' << result.phase << ','
+				<< std::fixed << std::setprecision(2) << result.ns_per_op_median << ',' << result.ns_per_op_min << ','
+				<< result.p50 << ',' << result.p99 << ',' << result.p999 << ',' << result.max << ','
+				<< result.bytes_per_element << ',' << result.peak_bytes << ',' << result.allocations << ','
+				<< std::setprecision(4) << result.fragmentation << '\n';
+		}
+	}
+
+	void write_json(std::ostream& out) const
+	{
+		out << "[\n";
+		for (std::size_t index = 0; index < _results.size(); ++index)
+		{
+			const auto& result = _results[index];
+			out << "  {\"container\": \"" << result.container << "\", \"workload\": \"" << result.workload
+				<< "\", \"size\": " << result.size << ", \"phase\": \"" << result.phase << "\", "
+				<< std::fixed << std::setprecision(2)
+				<< "\"ns_per_op_median\": " << result.ns_per_op_median << ", \"ns_per_op_min\": " << result.ns_per_op_min
+				<< ", \"p50_ns\": " << result.p50 << ", \"p99_ns\": " << result.p99
+				<< ", \"p999_ns\": " << result.p999 << ", \"max_ns\": " << result.max
+				<< ", \"bytes_per_element\": " << result.bytes_per_element << ", \"peak_bytes\": " << result.peak_bytes
+				<< ", \"allocations\": " << result.allocations
+				<< ", \"fragmentation\": " << std::setprecision(4) << result.fragmentation << '}'
+				<< (index + 1 < _results.size() ? ",\n" : "\n");
+		}
+		out << "]\n";
+	}
+
+private:
+	using _clock = std::chrono::steady_clock;
+
+	//measurements of one phase over all repetitions
+	struct _PhaseRecord
+	{
+		std::string phase;
+		std::vector<double> ns_per_op;
+		LatencyHistogram latency;
+		double bytes_per_element = 0;
+		std::size_t peak_bytes = 0;
+		std::size_t allocations = 0;
+		double fragmentation = 0;
+	};
+
+	static std::uint64_t _elapsed_ns(_clock::time_point start, _clock::time_point end)
+	{
+		return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+	}
+
+	//the least time two back to back clock reads ever take
+	static std::uint64_t _measure_clock_cost()
+	{
+		std::uint64_t cost = UINT64_MAX;
+		for (int count = 0; count < 1000; ++count)
+		{
+			auto start = _clock::now();
+			auto end = _clock::now();
+			cost = std::min(cost, _elapsed_ns(start, end));
+		}
+		return cost;
+	}
+
+	//run op(i) for every i < count, is_measured false means warmup
+	void _phase(
+		std::vector<_PhaseRecord>& records, std::size_t& next_record, const char* phase,
+		std::size_t count, bool is_measured, bool is_latency_run, auto&& op)
+	{
+		if (next_record == records.size()) { records.push_back({ phase, {}, {} }); }
+		_PhaseRecord& record = records[next_record++];
+
+		if (!is_latency_run)
+		{
+			auto start = _clock::now();
+			for (std::size_t index = 0; index < count; ++index) { op(index); }
+			auto end = _clock::now();
+			if (is_measured && count) { record.ns_per_op.push_back(static_cast<double>(_elapsed_ns(start, end)) / static_cast<double>(count)); }
+			return;
+		}
+
+		LatencyHistogram latency;
+		for (std::size_t index = 0; index < count; ++index)
+		{
+			auto start = _clock::now();
+			op(index);
+			auto end = _clock::now();
+			std::uint64_t elapsed = _elapsed_ns(start, end);
+			latency.record(elapsed > _clock_cost ? elapsed - _clock_cost : 0);
+		}
+		if (is_measured) { record.latency.merge(latency); }
+	}
+
+	//the map of the memory run, on counting when it takes a resource
+	template<typename _Map>
+	static _Map _make_counted(CountingResource& counting)
+	{
+		if constexpr (std::constructible_from<_Map, std::pmr::memory_resource*>) { return _Map(&counting); }
+		else { return _Map(); }
+	}
+
+	//what map holds after a phase of the memory run
+	template<typename _Map>
+	static void _record_memory(_PhaseRecord& record, _Map& map, const CountingResource& counting)
+	{
+		//an emptied map has no bytes per element
+		double size = static_cast<double>(map.size());
+		if constexpr (std::constructible_from<_Map, std::pmr::memory_resource*>)
+		{
+			record.bytes_per_element = size ? static_cast<double>(counting.live_bytes()) / size : 0;
+			record.peak_bytes = counting.peak_bytes();
+			record.allocations = counting.allocation_count();
+			record.fragmentation = counting.fragmentation();
+		}
+		else if constexpr (requires { map.memory_usage(); })
+		{
+			record.bytes_per_element = size ? static_cast<double>(map.memory_usage()) / size : 0;
+		}
+	}
+
+	//every phase of the workload once on map, after_phase(record) is called at the end of each one
+	template<typename _Map>
+	void _run_phases(
+		_Map& map, const BenchmarkWorkload& workload, std::vector<_PhaseRecord>& records,
+		bool is_measured, bool is_latency_run, std::size_t& hits, auto&& after_phase)
+	{
+		std::size_t next_record = 0;
+		if (workload.churn_keys.empty())
+		{
+			const auto& insert_keys = workload.insert_keys;
+			const auto& lookup_keys = workload.lookup_keys;
+			const auto& miss_keys = workload.miss_keys;
+			const auto& erase_keys = workload.erase_keys;
+			_phase(records, next_record, "insert", insert_keys.size(), is_measured, is_latency_run,
+				[&](std::size_t index) { benchmark_insert(map, insert_keys[index]); });
+			after_phase(records[next_record - 1]);
+			_phase(records, next_record, "find", lookup_keys.size(), is_measured, is_latency_run,
+				[&](std::size_t index) { hits += benchmark_find(map, lookup_keys[index]); });
+			after_phase(records[next_record - 1]);
+			_phase(records, next_record, "find_miss", miss_keys.size(), is_measured, is_latency_run,
+				[&](std::size_t index) { hits += benchmark_find(map, miss_keys[index]); });
+			after_phase(records[next_record - 1]);
+			_phase(records, next_record, "erase", erase_keys.size(), is_measured, is_latency_run,
+				[&](std::size_t index) { benchmark_erase(map, erase_keys[index]); });
+			after_phase(records[next_record - 1]);
+		}
+		else
+		{
+			const auto& old_keys = workload.insert_keys;
+			const auto& new_keys = workload.churn_keys;
+			for (int key : old_keys) { benchmark_insert(map, key); }
+			//one operation is one erase and one insert, the size stays the same
+			_phase(records, next_record, "churn", new_keys.size(), is_measured, is_latency_run,
+				[&](std::size_t index) {
+					benchmark_erase(map, old_keys[index]);
+					benchmark_insert(map, new_keys[index]);
+				});
+			after_phase(records[next_record - 1]);
+		}
+	}
+
+	template<typename _Map>
+	void _run(const std::string& name, const BenchmarkWorkload& workload)
+	{
+		std::vector<_PhaseRecord> records;
+		std::size_t hits = 0;
+		std::size_t run_count = _config.warmup + _config.repetitions;
+		for (std::size_t run = 0; run < 2 * run_count; ++run)
+		{
+			bool is_measured = run / 2 >= _config.warmup;
+			bool is_latency_run = run % 2 == 1;
+			_Map map;
+			_run_phases(map, workload, records, is_measured, is_latency_run, hits, [](_PhaseRecord&) {});
+		}
+
+		//the counting resource adds a call to every allocation, so memory is measured apart from the timed runs
+		{
+			CountingResource counting;
+			_Map map = _make_counted<_Map>(counting);
+			_run_phases(map, workload, records, false, false, hits,
+				[&](_PhaseRecord& record) { _record_memory(record, map, counting); });
+		}
+		//keeps the finds from being optimized out
+		_sink = _sink + hits;
+
+		for (auto& record : records)
+		{
+			BenchmarkResult result;
+			result.container = name;
+			result.workload = workload.name;
+			result.size = workload.insert_keys.size();
+			result.phase = record.phase;
+			if (!record.ns_per_op.empty())
+			{
+				std::sort(record.ns_per_op.begin(), record.ns_per_op.end());
+				result.ns_per_op_median = record.ns_per_op[record.ns_per_op.size() / 2];
+				result.ns_per_op_min = record.ns_per_op.front();
+			}
+			result.p50 = record.latency.percentile(0.5);
+			result.p99 = record.latency.percentile(0.99);
+			result.p999 = record.latency.percentile(0.999);
+			result.max = record.latency.max();
+			result.bytes_per_element = record.bytes_per_element;
+			result.peak_bytes = record.peak_bytes;
+			result.allocations = record.allocations;
+			result.fragmentation = record.fragmentation;
+			_results.push_back(std::move(result));
+		}
+	}
+
+	BenchmarkConfig _config;
+	std::uint64_t _clock_cost;
+	std::vector<std::pair<std::string, std::function<void(const std::string&, const BenchmarkWorkload&)>>> _runners;
+	std::vector<BenchmarkResult> _results;
+	volatile std::size_t _sink = 0;
+};
@@ -0,0 +1,889 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <optional>
+#include <functional>
+#include <utility>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <stdexcept>
+#include "avl.h"
+
+//epoch based reclamation
+//a thread inside a guard may still hold pointers to anything that was reachable when the guard started,
+//so an object retired at epoch e is only freed once every guard has moved past e + 1
+//the global epoch moves on when every thread inside a guard has seen its current value
+class EpochReclaimer
+{
+	struct _thread_record;
+
+public:
+	//threads that may use reclaimers at the same time, each one holds a slot from its first guard until it ends
+	static constexpr std::size_t max_threads = 256;
+
+	EpochReclaimer() = default;
+	EpochReclaimer(const EpochReclaimer&) = delete;
+	EpochReclaimer& operator=(const EpochReclaimer&) = delete;
+
+	//no thread may be inside a guard of this reclaimer any more
+	~EpochReclaimer()
+	{
+		for (auto& record : _records)
+		{
+			for (auto& retired : record.retired) { retired.deleter(retired.object); }
+		}
+	}
+
+	class guard
+	{
+	public:
+		//the epoch has to be visible before the first pointer is read, leaving only has to come after the last one
+		explicit guard(EpochReclaimer& reclaimer) : _record(reclaimer._records[this_thread_slot()])
+		{
+			_record.epoch.store(reclaimer._global_epoch.load());
+		}
+
+		~guard() { _record.epoch.store(_idle, std::memory_order_release); }
+
+		guard(const guard&) = delete;
+		guard& operator=(const guard&) = delete;
+
+	private:
+		_thread_record& _record;
+	};
+
+	//only inside a guard, object is given to deleter once no guard can see it any more
+	void retire(void* object, void (*deleter)(void*))
+	{
+		auto& record = _records[this_thread_slot()];
+		record.retired.push_back({ object, deleter, _global_epoch.load() });
+		if (record.retired.size() >= _collect_threshold) { _collect(record); }
+	}
+
+	//index of the calling thread, also usable by containers for per thread data
+	static std::size_t this_thread_slot()
+	{
+		struct slot_holder
+		{
+			std::size_t index;
+			slot_holder() : index(_acquire_slot()) {}
+			~slot_holder() { _is_slot_used[index].store(false, std::memory_order_release); }
+		};
+		thread_local slot_holder slot;
+		return slot.index;
+	}
+
+private:
+	static constexpr std::uint64_t _idle = 0;
+	//retired objects piling up before a thread tries to move the epoch and free its own ones
+	static constexpr std::size_t _collect_threshold = 128;
+
+	struct _retired
+	{
+		void* object;
+		void (*deleter)(void*);
+		std::uint64_t epoch;
+	};
+
+	//one cache line per thread, only its owner writes to it
+	//a thread reusing a slot takes over what the last owner retired
+	struct alignas(64) _thread_record
+	{
+		std::atomic<std::uint64_t> epoch{ _idle };
+		std::vector<_retired> retired;
+	};
+
+	static std::size_t _acquire_slot()
+	{
+		for (std::size_t index = 0; index < max_threads; ++index)
+		{
+			bool is_used = false;
+			if (_is_slot_used[index].compare_exchange_strong(is_used, true, std::memory_order_acquire)) { return index; }
+		}
+		throw std::runtime_error{ "EpochReclaimer: more than max_threads threads" };
+	}
+
+	void _collect(_thread_record& record)
+	{
+		std::uint64_t epoch = _global_epoch.load();
+		bool is_all_caught_up = std::all_of(std::begin(_records), std::end(_records), [epoch](const _thread_record& other) {
+			std::uint64_t other_epoch = other.epoch.load();
+			return other_epoch == _idle || other_epoch == epoch;
+		});
+		if (is_all_caught_up) { _global_epoch.compare_exchange_strong(epoch, epoch + 1); }
+
+		std::uint64_t current = _global_epoch.load();
+		if (current < 2) { return; }
+		auto freed = std::partition(record.retired.begin(), record.retired.end(),
+			[safe = current - 2](const _retired& retired) { return retired.epoch > safe; });
+		for (auto iter = freed; iter != record.retired.end(); ++iter) { iter->deleter(iter->object); }
+		record.retired.erase(freed, record.retired.end());
+	}
+
+	inline static std::atomic<bool> _is_slot_used[max_threads];
+
+	std::atomic<std::uint64_t> _global_epoch{ 1 };
+	_thread_record _records[max_threads];
+};
+
+//AVL for many threads inserting, erasing and finding at once, without a lock around the tree
+//after "A Practical Concurrent Binary Search Tree" (Bronson, Casper, Chafi, Olukotun, PPoPP 2010)
+//readers take no lock, they check a version number of each node before and after stepping down from it,
+//a rotation that moves a node down marks its version as changing and bumps it when done
+//writers lock only the nodes they change, parent before child
+//balance is relaxed, a thread fixes the heights and rotations its update caused after the update itself
+//erasing a node with two children only drops its value, the bare routing node is unlinked later
+//once it has at most one child
+//values are copied out, a reference could outlive the value while another thread replaces it
+template<typename _KeyTy, typename _ValTy, typename _Compare = std::less<_KeyTy>>
+requires key_compare_for<_Compare, _KeyTy> && std::copy_constructible<_KeyTy> && std::copy_constructible<_ValTy>
+class ConcurrentAVL
+{
+public:
+	using key_type = _KeyTy;
+	using value_type = _ValTy;
+	using key_compare = _Compare;
+
+private:
+#define FWD(FORWARD_REF) std::forward<decltype(FORWARD_REF)>(FORWARD_REF)
+
+	//version of a node: bit 0 changing, bit 1 unlinked, the rest counts finished changes
+	static constexpr std::uint64_t _changing = 1;
+	static constexpr std::uint64_t _unlinked = 2;
+
+	static bool _is_changing_or_unlinked(std::uint64_t version) { return version & (_changing | _unlinked); }
+	static std::uint64_t _begin_change(std::uint64_t version) { return version | _changing; }
+	static std::uint64_t _end_change(std::uint64_t version) { return (version | _changing | _unlinked) + 1; }
+
+	//test and test-and-set, locks are held for a few stores only
+	class _spin_lock
+	{
+	public:
+		void lock()
+		{
+			while (_is_locked.exchange(true, std::memory_order_acquire))
+			{
+				for (int spins = 0; _is_locked.load(std::memory_order_relaxed); ++spins)
+				{
+					if (spins > 64) { std::this_thread::yield(); }
+				}
+			}
+		}
+
+		void unlock() { _is_locked.store(false, std::memory_order_release); }
+
+	private:
+		std::atomic<bool> _is_locked{ false };
+	};
+
+	//replaced as a whole, so a reader never sees half of a new value
+	struct _Value
+	{
+		value_type value;
+	};
+
+	class _Node;
+
+	//everything of a node except the key, the holder above the root is only a _Link
+	class _Link
+	{
+	public:
+		std::atomic<std::uint64_t> _version{ 0 };
+		std::atomic<int> _height{ 0 };
+		std::atomic<_Node*> _child_left{ nullptr };
+		std::atomic<_Node*> _child_right{ nullptr };
+		std::atomic<_Link*> _parent{ nullptr };
+		//null for a routing node
+		std::atomic<_Value*> _value{ nullptr };
+		_spin_lock _lock;
+
+		std::atomic<_Node*>& _child(bool is_right) { return is_right ? _child_right : _child_left; }
+	};
+
+	class _Node : public _Link
+	{
+	public:
+		const key_type _key;
+
+		_Node(const key_type& key, _Link* parent, _Value* value) : _key(key)
+		{
+			this->_height.store(1, std::memory_order_relaxed);
+			this->_parent.store(parent, std::memory_order_relaxed);
+			this->_value.store(value, std::memory_order_relaxed);
+		}
+	};
+
+	static int _get_height(_Node* node)
+	{
+		return node ? node->_height.load() : 0;
+	}
+
+	//a parent may hold an old version while a rotation below it is still going on
+	//the changing thread holds the lock of node, so waiting for the lock is waiting for the change
+	static void _wait_until_change_done(_Link* node, std::uint64_t version)
+	{
+		if (!(version & _changing)) { return; }
+		for (int spins = 0; spins < 100; ++spins)
+		{
+			if (node->_version.load() != version) { return; }
+		}
+		node->_lock.lock();
+		node->_lock.unlock();
+	}
+
+	void _retire_node(_Node* node)
+	{
+		_reclaimer.retire(node, [](void* object) { delete static_cast<_Node*>(object); });
+	}
+
+	void _retire_value(_Value* value)
+	{
+		if (value) { _reclaimer.retire(value, [](void* object) { delete static_cast<_Value*>(object); }); }
+	}
+
+	//find
+
+	_Value* _find_impl(const key_type& key)
+	{
+		while (true)
+		{
+			_Node* root = _holder._child_right.load();
+			if (!root) { return nullptr; }
+
+			auto order = key_three_way(_comp, key, root->_key);
+			if (order == 0) { return root->_value.load(); }
+
+			std::uint64_t version = root->_version.load();
+			if (_is_changing_or_unlinked(version)) { _wait_until_change_done(root, version); }
+			else if (root == _holder._child_right.load())
+			{
+				_Value* result = nullptr;
+				if (_attempt_find(key, root, order > 0, version, result)) { return result; }
+			}
+		}
+	}
+
+	//false when node changed since version was read, the caller has to retry from its own node
+	bool _attempt_find(const key_type& key, _Node* node, bool is_right, std::uint64_t version, _Value*& result)
+	{
+		while (true)
+		{
+			_Node* child = node->_child(is_right).load();
+			if (!child)
+			{
+				if (node->_version.load() != version) { return false; }
+				result = nullptr;
+				return true;
+			}
+
+			auto order = key_three_way(_comp, key, child->_key);
+			if (order == 0)
+			{
+				result = child->_value.load();
+				return true;
+			}
+
+			std::uint64_t child_version = child->_version.load();
+			if (_is_changing_or_unlinked(child_version))
+			{
+				_wait_until_change_done(child, child_version);
+				if (node->_version.load() != version) { return false; }
+			}
+			else if (child != node->_child(is_right).load())
+			{
+				if (node->_version.load() != version) { return false; }
+			}
+			else
+			{
+				//child was still below node when its version was read, so the hand-over is valid
+				if (node->_version.load() != version) { return false; }
+				if (_attempt_find(key, child, order > 0, child_version, result)) { return true; }
+			}
+		}
+	}
+
+	//insert, assign and erase, new_value null means erase
+	//returns the value that was there before, null if there was none
+
+	_Value* _update_impl(const key_type& key, _Value* new_value)
+	{
+		while (true)
+		{
+			_Node* root = _holder._child_right.load();
+			if (!root)
+			{
+				if (!new_value) { return nullptr; }
+				if (_attempt_insert_into_empty(key, new_value)) { return nullptr; }
+			}
+			else
+			{
+				std::uint64_t version = root->_version.load();
+				if (_is_changing_or_unlinked(version)) { _wait_until_change_done(root, version); }
+				else if (root == _holder._child_right.load())
+				{
+					_Value* previous = nullptr;
+					if (_attempt_update(key, new_value, &_holder, root, version, previous)) { return previous; }
+				}
+			}
+		}
+	}
+
+	bool _attempt_insert_into_empty(const key_type& key, _Value* new_value)
+	{
+		std::lock_guard holder_lock(_holder._lock);
+		if (_holder._child_right.load()) { return false; }
+		_holder._child_right.store(new _Node(key, &_holder, new_value));
+		return true;
+	}
+
+	bool _attempt_update(
+		const key_type& key, _Value* new_value,
+		_Link* parent, _Node* node, std::uint64_t version, _Value*& previous)
+	{
+		auto order = key_three_way(_comp, key, node->_key);
+		if (order == 0) { return _attempt_node_update(new_value, parent, node, previous); }
+
+		bool is_right = order > 0;
+		while (true)
+		{
+			_Node* child = node->_child(is_right).load();
+			if (node->_version.load() != version) { return false; }
+
+			if (!child)
+			{
+				if (!new_value) //nothing to erase
+				{
+					previous = nullptr;
+					return true;
+				}
+
+				bool is_inserted = false;
+				_Link* damaged = nullptr;
+				{
+					std::lock_guard node_lock(node->_lock);
+					if (node->_version.load() != version) { return false; }
+					//another insert may have taken the place in the meantime, then look again
+					if (!node->_child(is_right).load())
+					{
+						node->_child(is_right).store(new _Node(key, node, new_value));
+						is_inserted = true;
+						damaged = _fix_height_nl(node);
+					}
+				}
+				if (is_inserted)
+				{
+					_fix_height_and_rebalance(damaged);
+					previous = nullptr;
+					return true;
+				}
+			}
+			else
+			{
+				std::uint64_t child_version = child->_version.load();
+				if (_is_changing_or_unlinked(child_version)) { _wait_until_change_done(child, child_version); }
+				else if (child == node->_child(is_right).load())
+				{
+					if (node->_version.load() != version) { return false; }
+					if (_attempt_update(key, new_value, node, child, child_version, previous)) { return true; }
+				}
+			}
+		}
+	}
+
+	bool _attempt_node_update(_Value* new_value, _Link* parent, _Node* node, _Value*& previous)
+	{
+		if (!new_value && !node->_value.load())
+		{
+			previous = nullptr;
+			return true;
+		}
+
+		if (!new_value && (!node->_child_left.load() || !node->_child_right.load()))
+		{
+			//this erase can unlink node, which needs the parent locked first
+			{
+				std::lock_guard parent_lock(parent->_lock);
+				if ((parent->_version.load() & _unlinked) || node->_parent.load() != parent) { return false; }
+
+				std::lock_guard node_lock(node->_lock);
+				previous = node->_value.load();
+				if (!previous) { return true; }
+				if (!_attempt_unlink_nl(parent, node)) { return false; }
+				_retire_node(node);
+			}
+			_fix_height_and_rebalance(parent);
+			return true;
+		}
+
+		std::lock_guard node_lock(node->_lock);
+		if (node->_version.load() & _unlinked) { return false; }
+		//children may have gone meanwhile, then this erase has to take the unlinking way
+		if (!new_value && (!node->_child_left.load() || !node->_child_right.load())) { return false; }
+		previous = node->_value.exchange(new_value);
+		return true;
+	}
+
+	//parent and node are locked
+	bool _attempt_unlink_nl(_Link* parent, _Node* node)
+	{
+		_Node* parent_left = parent->_child_left.load();
+		_Node* parent_right = parent->_child_right.load();
+		if (parent_left != node && parent_right != node) { return false; }
+
+		_Node* left = node->_child_left.load();
+		_Node* right = node->_child_right.load();
+		if (left && right) { return false; }
+
+		_Node* splice = left ? left : right;
+		(parent_left == node ? parent->_child_left : parent->_child_right).store(splice);
+		if (splice) { splice->_parent.store(parent); }
+		node->_version.store(_unlinked);
+		node->_value.store(nullptr);
+		return true;
+	}
+
+	//rebalancing, every _nl function runs with the locks of the nodes it is given
+	//each of them returns the next node that may need a fix, or null when the damage is repaired
+
+	static constexpr int _unlink_required = -1;
+	static constexpr int _rebalance_required = -2;
+	static constexpr int _nothing_required = -3;
+
+	//the new height of node if only its height is wrong, otherwise one of the codes above
+	static int _node_condition(_Link* node)
+	{
+		_Node* left = node->_child_left.load();
+		_Node* right = node->_child_right.load();
+		if ((!left || !right) && !node->_value.load()) { return _unlink_required; }
+
+		int height = node->_height.load();
+		int left_height = _get_height(left);
+		int right_height = _get_height(right);
+		int new_height = 1 + std::max(left_height, right_height);
+		int balance = left_height - right_height;
+		if (balance < -1 || balance > 1) { return _rebalance_required; }
+		return height != new_height ? new_height : _nothing_required;
+	}
+
+	void _fix_height_and_rebalance(_Link* node)
+	{
+		//the holder has no parent, reaching it means the whole path is fixed
+		while (node && node->_parent.load())
+		{
+			int condition = _node_condition(node);
+			if (condition == _nothing_required || (node->_version.load() & _unlinked)) { return; }
+
+			if (condition != _unlink_required && condition != _rebalance_required)
+			{
+				std::lock_guard node_lock(node->_lock);
+				node = _fix_height_nl(node);
+			}
+			else
+			{
+				_Link* parent = node->_parent.load();
+				std::lock_guard parent_lock(parent->_lock);
+				if (!(parent->_version.load() & _unlinked) && node->_parent.load() == parent)
+				{
+					std::lock_guard node_lock(node->_lock);
+					node = _rebalance_nl(parent, static_cast<_Node*>(node));
+				}
+			}
+		}
+	}
+
+	static _Link* _fix_height_nl(_Link* node)
+	{
+		int condition = _node_condition(node);
+		switch (condition)
+		{
+		case _rebalance_required:
+		case _unlink_required:
+			return node;
+		case _nothing_required:
+			return nullptr;
+		default:
+			node->_height.store(condition);
+			return node->_parent.load();
+		}
+	}
+
+	_Link* _rebalance_nl(_Link* parent, _Node* node)
+	{
+		_Node* left = node->_child_left.load();
+		_Node* right = node->_child_right.load();
+		if ((!left || !right) && !node->_value.load())
+		{
+			if (_attempt_unlink_nl(parent, node))
+			{
+				_retire_node(node);
+				return _fix_height_nl(parent);
+			}
+			return node;
+		}
+
+		int height = node->_height.load();
+		int left_height = _get_height(left);
+		int right_height = _get_height(right);
+		int new_height = 1 + std::max(left_height, right_height);
+		int balance = left_height - right_height;
+		if (balance > 1) { return _rebalance_to_right_nl(parent, node, left, right_height); }
+		if (balance < -1) { return _rebalance_to_left_nl(parent, node, right, left_height); }
+		if (new_height != height)
+		{
+			node->_height.store(new_height);
+			return _fix_height_nl(parent);
+		}
+		return nullptr;
+	}
+
+	//left of node is too tall, rotate node right, first rotate left its left child if that one leans right
+	_Link* _rebalance_to_right_nl(_Link* parent, _Node* node, _Node* left, int right_height)
+	{
+		std::lock_guard left_lock(left->_lock);
+		int left_height = left->_height.load();
+		if (left_height - right_height <= 1) { return node; }
+
+		_Node* left_right = left->_child_right.load();
+		int left_left_height = _get_height(left->_child_left.load());
+		int left_right_height = _get_height(left_right);
+		if (left_left_height >= left_right_height)
+		{
+			return _rotate_right_nl(parent, node, left, right_height, left_left_height, left_right, left_right_height);
+		}
+
+		{
+			std::lock_guard left_right_lock(left_right->_lock);
+			//the height read before the lock may be stale, a single rotation may be enough after all
+			left_right_height = left_right->_height.load();
+			if (left_left_height >= left_right_height)
+			{
+				return _rotate_right_nl(parent, node, left, right_height, left_left_height, left_right, left_right_height);
+			}
+
+			//a double rotation is only done when it leaves left balanced
+			//so that all damage it leaves is on one path, left_right below the parent and node below left_right
+			int left_right_left_height = _get_height(left_right->_child_left.load());
+			int balance = left_left_height - left_right_left_height;
+			if (balance >= -1 && balance <= 1)
+			{
+				return _rotate_right_over_left_nl(parent, node, left, right_height, left_left_height, left_right, left_right_left_height);
+			}
+		}
+		//fix left on its own first, node is looked at again afterwards
+		return _rebalance_to_left_nl(node, left, left_right, left_left_height);
+	}
+
+	//mirror of _rebalance_to_right_nl
+	_Link* _rebalance_to_left_nl(_Link* parent, _Node* node, _Node* right, int left_height)
+	{
+		std::lock_guard right_lock(right->_lock);
+		int right_height = right->_height.load();
+		if (right_height - left_height <= 1) { return node; }
+
+		_Node* right_left = right->_child_left.load();
+		int right_right_height = _get_height(right->_child_right.load());
+		int right_left_height = _get_height(right_left);
+		if (right_right_height >= right_left_height)
+		{
+			return _rotate_left_nl(parent, node, left_height, right, right_left, right_left_height, right_right_height);
+		}
+
+		{
+			std::lock_guard right_left_lock(right_left->_lock);
+			right_left_height = right_left->_height.load();
+			if (right_right_height >= right_left_height)
+			{
+				return _rotate_left_nl(parent, node, left_height, right, right_left, right_left_height, right_right_height);
+			}
+
+			int right_left_right_height = _get_height(right_left->_child_right.load());
+			int balance = right_right_height - right_left_right_height;
+			if (balance >= -1 && balance <= 1)
+			{
+				return _rotate_left_over_right_nl(parent, node, left_height, right, right_left, right_right_height, right_left_right_height);
+			}
+		}
+		return _rebalance_to_right_nl(node, right, right_left, right_right_height);
+	}
+
+	void _replace_child_nl(_Link* parent, _Node* old_child, _Node* new_child)
+	{
+		if (parent->_child_left.load() == old_child) { parent->_child_left.store(new_child); }
+		else { parent->_child_right.store(new_child); }
+		new_child->_parent.store(parent);
+	}
+
+	//a rotation may leave node as a routing node with at most one child
+	//it is locked together with its new parent, so it goes at once instead of being left as damage off the path
+	bool _unlink_if_routing_nl(_Link* parent, _Node* node)
+	{
+		if (node->_value.load() || (node->_child_left.load() && node->_child_right.load())) { return false; }
+		//a node still linked must not be retired, the caller then goes on as if it was kept
+		if (!_attempt_unlink_nl(parent, node)) { return false; }
+		_retire_node(node);
+		return true;
+	}
+
+	//after a rotation node is the deepest damaged one, fix as much as the locks held allow
+	//anything still damaged is on the path from node up to parent, so the caller goes on from what is returned
+	_Link* _rotate_right_nl(
+		_Link* parent, _Node* node, _Node* left,
+		int right_height, int left_left_height, _Node* left_right, int left_right_height)
+	{
+		std::uint64_t version = node->_version.load();
+		node->_version.store(_begin_change(version));
+
+		node->_child_left.store(left_right);
+		if (left_right) { left_right->_parent.store(node); }
+		left->_child_right.store(node);
+		node->_parent.store(left);
+		_replace_child_nl(parent, node, left);
+
+		int node_height = 1 + std::max(left_right_height, right_height);
+		node->_height.store(node_height);
+
+		node->_version.store(_end_change(version));
+
+		bool is_node_unlinked = _unlink_if_routing_nl(left, node);
+		if (is_node_unlinked) { --node_height; }
+		left->_height.store(1 + std::max(left_left_height, node_height));
+
+		int node_balance = left_right_height - right_height;
+		if (!is_node_unlinked && (node_balance < -1 || node_balance > 1)) { return node; }
+		int left_balance = left_left_height - node_height;
+		if (left_balance < -1 || left_balance > 1) { return left; }
+		if (left_left_height == 0 && !left->_value.load()) { return left; }
+		return _fix_height_nl(parent);
+	}
+
+	_Link* _rotate_left_nl(
+		_Link* parent, _Node* node, int left_height,
+		_Node* right, _Node* right_left, int right_left_height, int right_right_height)
+	{
+		std::uint64_t version = node->_version.load();
+		node->_version.store(_begin_change(version));
+
+		node->_child_right.store(right_left);
+		if (right_left) { right_left->_parent.store(node); }
+		right->_child_left.store(node);
+		node->_parent.store(right);
+		_replace_child_nl(parent, node, right);
+
+		int node_height = 1 + std::max(left_height, right_left_height);
+		node->_height.store(node_height);
+
+		node->_version.store(_end_change(version));
+
+		bool is_node_unlinked = _unlink_if_routing_nl(right, node);
+		if (is_node_unlinked) { --node_height; }
+		right->_height.store(1 + std::max(node_height, right_right_height));
+
+		int node_balance = right_left_height - left_height;
+		if (!is_node_unlinked && (node_balance < -1 || node_balance > 1)) { return node; }
+		int right_balance = right_right_height - node_height;
+		if (right_balance < -1 || right_balance > 1) { return right; }
+		if (right_right_height == 0 && !right->_value.load()) { return right; }
+		return _fix_height_nl(parent);
+	}
+
+	_Link* _rotate_right_over_left_nl(
+		_Link* parent, _Node* node, _Node* left,
+		int right_height, int left_left_height, _Node* left_right, int left_right_left_height)
+	{
+		std::uint64_t version = node->_version.load();
+		std::uint64_t left_version = left->_version.load();
+		_Node* left_right_left = left_right->_child_left.load();
+		_Node* left_right_right = left_right->_child_right.load();
+		int left_right_right_height = _get_height(left_right_right);
+
+		node->_version.store(_begin_change(version));
+		left->_version.store(_begin_change(left_version));
+
+		node->_child_left.store(left_right_right);
+		if (left_right_right) { left_right_right->_parent.store(node); }
+		left->_child_right.store(left_right_left);
+		if (left_right_left) { left_right_left->_parent.store(left); }
+		left_right->_child_left.store(left);
+		left->_parent.store(left_right);
+		left_right->_child_right.store(node);
+		node->_parent.store(left_right);
+		_replace_child_nl(parent, node, left_right);
+
+		int node_height = 1 + std::max(left_right_right_height, right_height);
+		node->_height.store(node_height);
+		int left_new_height = 1 + std::max(left_left_height, left_right_left_height);
+		left->_height.store(left_new_height);
+
+		node->_version.store(_end_change(version));
+		left->_version.store(_end_change(left_version));
+
+		if (_unlink_if_routing_nl(left_right, left)) { --left_new_height; }
+		bool is_node_unlinked = _unlink_if_routing_nl(left_right, node);
+		if (is_node_unlinked) { --node_height; }
+		left_right->_height.store(1 + std::max(left_new_height, node_height));
+
+		int node_balance = left_right_right_height - right_height;
+		if (!is_node_unlinked && (node_balance < -1 || node_balance > 1)) { return node; }
+		int left_right_balance = left_new_height - node_height;
+		if (left_right_balance < -1 || left_right_balance > 1) { return left_right; }
+		return _fix_height_nl(parent);
+	}
+
+	_Link* _rotate_left_over_right_nl(
+		_Link* parent, _Node* node, int left_height,
+		_Node* right, _Node* right_left, int right_right_height, int right_left_right_height)
+	{
+		std::uint64_t version = node->_version.load();
+		std::uint64_t right_version = right->_version.load();
+		_Node* right_left_left = right_left->_child_left.load();
+		_Node* right_left_right = right_left->_child_right.load();
+		int right_left_left_height = _get_height(right_left_left);
+
+		node->_version.store(_begin_change(version));
+		right->_version.store(_begin_change(right_version));
+
+		node->_child_right.store(right_left_left);
+		if (right_left_left) { right_left_left->_parent.store(node); }
+		right->_child_left.store(right_left_right);
+		if (right_left_right) { right_left_right->_parent.store(right); }
+		right_left->_child_right.store(right);
+		right->_parent.store(right_left);
+		right_left->_child_left.store(node);
+		node->_parent.store(right_left);
+		_replace_child_nl(parent, node, right_left);
+
+		int node_height = 1 + std::max(left_height, right_left_left_height);
+		node->_height.store(node_height);
+		int right_new_height = 1 + std::max(right_left_right_height, right_right_height);
+		right->_height.store(right_new_height);
+
+		node->_version.store(_end_change(version));
+		right->_version.store(_end_change(right_version));
+
+		if (_unlink_if_routing_nl(right_left, right)) { --right_new_height; }
+		bool is_node_unlinked = _unlink_if_routing_nl(right_left, node);
+		if (is_node_unlinked) { --node_height; }
+		right_left->_height.store(1 + std::max(node_height, right_new_height));
+
+		int node_balance = right_left_left_height - left_height;
+		if (!is_node_unlinked && (node_balance < -1 || node_balance > 1)) { return node; }
+		int right_left_balance = right_new_height - node_height;
+		if (right_left_balance < -1 || right_left_balance > 1) { return right_left; }
+		return _fix_height_nl(parent);
+	}
+
+	static void _destroy_impl(_Node* root)
+	{
+		if (!root) { return; }
+		_destroy_impl(root->_child_left.load(std::memory_order_relaxed));
+		_destroy_impl(root->_child_right.load(std::memory_order_relaxed));
+		delete root->_value.load(std::memory_order_relaxed);
+		delete root;
+	}
+
+	//one counter per thread slot, so counting the size does not make every update share one cache line
+	struct alignas(64) _size_counter
+	{
+		std::atomic<std::ptrdiff_t> value{ 0 };
+	};
+
+	void _add_size(std::ptrdiff_t delta)
+	{
+		auto& counter = _size_counters[EpochReclaimer::this_thread_slot()].value;
+		counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+	}
+
+	//the tree hangs on the right of the holder
+	_Link _holder;
+	mutable EpochReclaimer _reclaimer;
+	_size_counter _size_counters[EpochReclaimer::max_threads];
+	_Compare _comp;
+
+public:
+	ConcurrentAVL() : ConcurrentAVL(_Compare()) {}
+	explicit ConcurrentAVL(const _Compare& comp) : _comp(comp) {}
+
+	ConcurrentAVL(const ConcurrentAVL&) = delete;
+	ConcurrentAVL& operator=(const ConcurrentAVL&) = delete;
+
+	//no other thread may use the tree any more
+	~ConcurrentAVL() { _destroy_impl(_holder._child_right.load()); }
+
+	//exact when no update is running
+	std::size_t size() const
+	{
+		std::ptrdiff_t size = 0;
+		for (const auto& counter : _size_counters) { size += counter.value.load(std::memory_order_relaxed); }
+		return static_cast<std::size_t>(size);
+	}
+
+	[[nodiscard]]
+	std::optional<value_type> find(const key_type& key) const
+	{
+		EpochReclaimer::guard guard(_reclaimer);
+		_Value* value = const_cast<ConcurrentAVL*>(this)->_find_impl(key);
+		if (value) { return value->value; }
+		else { return std::nullopt; }
+	}
+
+	//the bool is true when key was not in the tree before
+	bool insert_or_assign(const key_type& key, is_cvref_t_of<value_type> auto&& value)
+	{
+		_Value* new_value = new _Value{ FWD(value) };
+		EpochReclaimer::guard guard(_reclaimer);
+		_Value* previous = _update_impl(key, new_value);
+		if (!previous)
+		{
+			_add_size(1);
+			return true;
+		}
+		_retire_value(previous);
+		return false;
+	}
+
+	ConcurrentAVL& insert(const key_type& key, is_cvref_t_of<value_type> auto&& value)
+	{
+		insert_or_assign(key, FWD(value));
+		return *this;
+	}
+
+	//the bool is true when key was in the tree
+	bool erase(const key_type& key)
+	{
+		EpochReclaimer::guard guard(_reclaimer);
+		_Value* previous = _update_impl(key, nullptr);
+		if (!previous) { return false; }
+		_add_size(-1);
+		_retire_value(previous);
+		return true;
+	}
+
+	//DEBUG
+	//only when no update is running: keys in order, heights right, balanced, no routing node with less than two children
+	void DFS_debug_check() const
+	{
+		const key_type* last_key = nullptr;
+		_check_impl(_holder._child_right.load(), &_holder, last_key);
+	}
+
+private:
+	int _check_impl(_Node* root, const _Link* parent, const key_type*& last_key) const
+	{
+		if (!root) { return 0; }
+		assert(root->_parent.load() == parent);
+		assert(!(root->_version.load() & (_changing | _unlinked)));
+		int left_height = _check_impl(root->_child_left.load(), root, last_key);
+		assert(!last_key || key_less(_comp, *last_key, root->_key));
+		last_key = &root->_key;
+		int right_height = _check_impl(root->_child_right.load(), root, last_key);
+		assert(root->_height.load() == 1 + std::max(left_height, right_height));
+		assert(left_height - right_height >= -1 && left_height - right_height <= 1);
+		assert(root->_value.load() || (root->_child_left.load() && root->_child_right.load()));
+		return root->_height.load();
+	}
+};
+
+#undef FWD
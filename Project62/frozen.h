@@ -0,0 +1,452 @@
+#pragma once
+#include <concepts>
+#include <cstddef>
+#include <utility>
+#include <optional>
+#include <functional>
+#include <iterator>
+#include <vector>
+#include <bit>
+#include <algorithm>
+#include <memory>
+#include <span>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <filesystem>
+#include <stdexcept>
+#include <type_traits>
+#include "mapped_file.h"
+#if defined(_MSC_VER) || defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+//read-only snapshot of a sorted map, made by AVL::freeze
+//keys are kept in Eytzinger order (the BFS order of a complete binary tree, children of k at 2k and 2k + 1),
+//so the first levels of every search share a few cache lines and a descent needs no pointer at all
+//values sit in a separate array with the same indices, a search only touches keys
+//for AVL<int, double> an entry takes 12 bytes instead of a 32 bytes node
+//with trivially copyable keys and values the two arrays can be saved as an image file and mapped back in,
+//a mapped snapshot searches the file's pages in place, see save and open_mapped
+template<typename _KeyTy, typename _ValTy, typename _Compare = std::less<_KeyTy>>
+class FrozenTree
+{
+public:
+	using key_type = _KeyTy;
+	using value_type = _ValTy;
+	using key_compare = _Compare;
+
+private:
+	//one cache line of keys, a node 4 levels further down starts at _keys[k * _prefetch_stride]
+	static constexpr std::size_t _prefetch_stride = std::max<std::size_t>(1, 64 / sizeof(key_type));
+
+	static void _prefetch(const void* address)
+	{
+#if defined(_MSC_VER) || defined(__SSE__)
+		_mm_prefetch(static_cast<const char*>(address), _MM_HINT_T0);
+#elif defined(__GNUC__)
+		__builtin_prefetch(address);
+#endif
+	}
+
+	bool _less(const key_type& lhs, const key_type& rhs) const
+	{
+		if constexpr (std::is_convertible_v<decltype(_comp(lhs, rhs)), bool>) { return _comp(lhs, rhs); }
+		else { return _comp(lhs, rhs) < 0; }
+	}
+
+	//walk down the implicit tree, going right adds 1 to the index, so the loop has no branch on the keys
+	//when it falls off the tree, the trailing 1 bits of k are the right turns taken since the last left turn
+	//dropping them and that left turn gives the last node the search went left at, 0 if there is none
+	template<bool _is_upper>
+	std::size_t _bound_index(const key_type& key) const
+	{
+		std::size_t k = 1;
+		while (k <= _size)
+		{
+			if (k * _prefetch_stride <= _size) { _prefetch(_keys + k * _prefetch_stride); }
+			bool is_right = _is_upper ? !_less(key, _keys[k]) : _less(_keys[k], key);
+			k = 2 * k + static_cast<std::size_t>(is_right);
+		}
+		return k >> (std::countr_one(k) + 1);
+	}
+
+	//in-order successor and predecessor in the implicit tree, 0 is end
+	std::size_t _next_index(std::size_t k) const
+	{
+		if (2 * k + 1 <= _size)
+		{
+			k = 2 * k + 1;
+			while (2 * k <= _size) { k = 2 * k; }
+			return k;
+		}
+		return k >> (std::countr_one(k) + 1);
+	}
+
+	std::size_t _prev_index(std::size_t k) const
+	{
+		if (k == 0) { return _size ? _rightmost() : 0; }
+		if (2 * k <= _size)
+		{
+			k = 2 * k;
+			while (2 * k + 1 <= _size) { k = 2 * k + 1; }
+			return k;
+		}
+		return k >> (std::countr_zero(k) + 1);
+	}
+
+	//the arrays of a snapshot made in memory, both empty when the arrays are in a mapped image
+	std::vector<key_type> _key_storage;
+	std::vector<value_type> _value_storage;
+	std::shared_ptr<const MappedFile> _image;
+	//slot 0 of _keys is a copy of some key so that the tree can be indexed from 1, _values has no such slot
+	const key_type* _keys = nullptr;
+	const value_type* _values = nullptr;
+	std::size_t _size = 0;
+	_Compare _comp;
+
+	static constexpr bool _is_mappable = std::is_trivially_copyable_v<key_type> && std::is_trivially_copyable_v<value_type>;
+
+	//image file layout: this header, then the keys from keys_offset, then the values from values_offset
+	//both arrays are stored as they are in memory, so an image only opens on a machine with the same types and byte order
+	//the header checksum is checked on open, the payload checksum only by verify, which reads the whole file
+	struct _ImageHeader
+	{
+		char magic[8];
+		std::uint32_t version;
+		std::uint32_t byte_order;
+		std::uint32_t key_size;
+		std::uint32_t key_align;
+		std::uint32_t value_size;
+		std::uint32_t value_align;
+		std::uint64_t size;
+		std::uint64_t keys_offset;
+		std::uint64_t values_offset;
+		std::uint64_t file_size;
+		std::uint64_t payload_checksum;
+		//of the header with this field set to 0
+		std::uint64_t header_checksum;
+	};
+
+	static constexpr char _image_magic[8] = { 'A', 'V', 'L', 'F', 'R', 'O', 'Z', 'N' };
+	static constexpr std::uint32_t _image_version = 1;
+	//reads back as another number on a machine of the other byte order
+	static constexpr std::uint32_t _image_byte_order = 0x01020304;
+	//the arrays start on a cache line, which is more than any key or value needs
+	static constexpr std::size_t _image_align = 64;
+
+	static constexpr std::size_t _align_up(std::size_t offset)
+	{
+		return (offset + _image_align - 1) / _image_align * _image_align;
+	}
+
+	//FNV-1a over 8-byte words, a changed bit anywhere changes the result
+	//pass the result of one array as the seed of the next to cover both
+	static std::uint64_t _checksum(std::span<const std::byte> bytes, std::uint64_t hash = 0xcbf29ce484222325)
+	{
+		constexpr std::uint64_t prime = 0x100000001b3;
+		std::size_t index = 0;
+		for (; index + sizeof(std::uint64_t) <= bytes.size(); index += sizeof(std::uint64_t))
+		{
+			std::uint64_t word;
+			std::memcpy(&word, bytes.data() + index, sizeof(word));
+			hash = (hash ^ word) * prime;
+		}
+		for (; index < bytes.size(); ++index) { hash = (hash ^ std::to_integer<std::uint64_t>(bytes[index])) * prime; }
+		return hash;
+	}
+
+	static std::uint64_t _header_checksum(_ImageHeader header)
+	{
+		header.header_checksum = 0;
+		return _checksum(std::as_bytes(std::span{ &header, 1 }));
+	}
+
+	//slot 0 included, an empty snapshot has no keys at all
+	std::size_t _key_count() const noexcept { return _size ? _size + 1 : 0; }
+
+	std::uint64_t _payload_checksum() const
+	{
+		return _checksum(std::as_bytes(std::span{ _values, _size }),
+			_checksum(std::as_bytes(std::span{ _keys, _key_count() })));
+	}
+
+public:
+	//bidirectional iterator over keys in order, it is only an index and never invalidated
+	class const_iterator
+	{
+		friend class FrozenTree;
+
+	public:
+		using iterator_category = std::bidirectional_iterator_tag;
+		using difference_type = std::ptrdiff_t;
+		using value_type = std::pair<const _KeyTy, _ValTy>;
+		using reference = std::pair<const _KeyTy&, const _ValTy&>;
+
+		struct pointer
+		{
+			reference _ref;
+			const reference* operator->() const { return &_ref; }
+		};
+
+		const_iterator() = default;
+
+		reference operator*() const { return { key(), value() }; }
+		pointer operator->() const { return { **this }; }
+		const key_type& key() const { return _tree->_keys[_index]; }
+		const _ValTy& value() const { return _tree->_values[_index - 1]; }
+
+		const_iterator& operator++()
+		{
+			_index = _tree->_next_index(_index);
+			return *this;
+		}
+
+		const_iterator& operator--()
+		{
+			_index = _tree->_prev_index(_index);
+			return *this;
+		}
+
+		const_iterator operator++(int)
+		{
+			const_iterator old = *this;
+			++*this;
+			return old;
+		}
+
+		const_iterator operator--(int)
+		{
+			const_iterator old = *this;
+			--*this;
+			return old;
+		}
+
+		friend bool operator==(const const_iterator& lhs, const const_iterator& rhs)
+		{
+			return lhs._index == rhs._index;
+		}
+
+	private:
+		const_iterator(const FrozenTree* tree, std::size_t index) : _tree(tree), _index(index) {}
+
+		const FrozenTree* _tree = nullptr;
+		//Eytzinger index of the current key, 0 is end
+		std::size_t _index = 0;
+	};
+
+	using iterator = const_iterator;
+
+	FrozenTree() = default;
+
+	//[first, last) holds pair-like elements with strictly increasing keys
+	//only the legacy category is checked, iterators handing out a pair of references are not C++20 input iterators
+	template<typename _It>
+	requires std::derived_from<typename std::iterator_traits<_It>::iterator_category, std::forward_iterator_tag>
+	FrozenTree(_It first, _It last, const _Compare& comp = _Compare()) : _comp(comp)
+	{
+		_size = static_cast<std::size_t>(std::distance(first, last));
+		if (_size == 0) { return; }
+
+		//sorted position of every Eytzinger index, from an in-order walk of the implicit tree
+		std::vector<std::size_t> position(_size + 1);
+		std::size_t next_position = 0;
+		for (std::size_t k = _leftmost(); k; k = _next_index(k)) { position[k] = next_position++; }
+
+		std::vector<std::pair<key_type, value_type>> elements;
+		elements.reserve(_size);
+		for (; first != last; ++first)
+		{
+			auto&& element = *first;
+			elements.emplace_back(std::get<0>(element), std::get<1>(element));
+		}
+
+		_key_storage.reserve(_size + 1);
+		_value_storage.reserve(_size);
+		_key_storage.push_back(elements.front().first);
+		for (std::size_t k = 1; k <= _size; ++k)
+		{
+			_key_storage.push_back(std::move(elements[position[k]].first));
+			_value_storage.push_back(std::move(elements[position[k]].second));
+		}
+		_keys = _key_storage.data();
+		_values = _value_storage.data();
+	}
+
+	//a copy shares the image of a mapped snapshot, and copies the arrays of any other
+	FrozenTree(const FrozenTree& other) :
+		_key_storage(other._key_storage), _value_storage(other._value_storage), _image(other._image),
+		_keys(_image ? other._keys : _key_storage.data()), _values(_image ? other._values : _value_storage.data()),
+		_size(other._size), _comp(other._comp) {}
+
+	//the moved-from snapshot is left empty, its pointers would otherwise still reach into the arrays it gave away
+	FrozenTree(FrozenTree&& other) noexcept :
+		_key_storage(std::move(other._key_storage)), _value_storage(std::move(other._value_storage)),
+		_image(std::move(other._image)),
+		_keys(_image ? other._keys : _key_storage.data()),
+		_values(_image ? other._values : _value_storage.data()),
+		_size(std::exchange(other._size, 0)), _comp(other._comp)
+	{
+		other._keys = nullptr;
+		other._values = nullptr;
+	}
+
+	FrozenTree& operator=(FrozenTree&& other) noexcept
+	{
+		if (this != &other)
+		{
+			_key_storage = std::move(other._key_storage);
+			_value_storage = std::move(other._value_storage);
+			_image = std::move(other._image);
+			_keys = _image ? other._keys : _key_storage.data();
+			_values = _image ? other._values : _value_storage.data();
+			_size = std::exchange(other._size, 0);
+			_comp = other._comp;
+			other._key_storage.clear();
+			other._value_storage.clear();
+			other._keys = nullptr;
+			other._values = nullptr;
+		}
+		return *this;
+	}
+
+	FrozenTree& operator=(const FrozenTree& other)
+	{
+		if (this != &other) { *this = FrozenTree(other); }
+		return *this;
+	}
+
+	//write the snapshot as an image file, see _ImageHeader
+	//the image is written next to path and renamed over it, processes mapping the old file keep reading the old one
+	void save(const std::filesystem::path& path) const requires _is_mappable
+	{
+		_ImageHeader header{};
+		std::memcpy(header.magic, _image_magic, sizeof(header.magic));
+		header.version = _image_version;
+		header.byte_order = _image_byte_order;
+		header.key_size = sizeof(key_type);
+		header.key_align = alignof(key_type);
+		header.value_size = sizeof(value_type);
+		header.value_align = alignof(value_type);
+		header.size = _size;
+		header.keys_offset = _align_up(sizeof(_ImageHeader));
+		header.values_offset = _align_up(header.keys_offset + _key_count() * sizeof(key_type));
+		header.file_size = header.values_offset + _size * sizeof(value_type);
+		header.payload_checksum = _payload_checksum();
+		header.header_checksum = _header_checksum(header);
+
+		std::filesystem::path temporary_path = path;
+		temporary_path += ".tmp";
+		{
+			std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+			if (!file) { throw std::runtime_error{ "FrozenTree::save: cannot create " + temporary_path.string() }; }
+			const char padding[_image_align] = {};
+			auto write_at = [&file, &padding](std::uint64_t offset, const void* data, std::size_t bytes) {
+				file.write(padding, static_cast<std::streamsize>(offset - static_cast<std::uint64_t>(file.tellp())));
+				file.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+			};
+			write_at(0, &header, sizeof(header));
+			write_at(header.keys_offset, _keys, _key_count() * sizeof(key_type));
+			write_at(header.values_offset, _values, _size * sizeof(value_type));
+			file.flush();
+			if (!file) { throw std::runtime_error{ "FrozenTree::save: cannot write " + temporary_path.string() }; }
+		}
+		std::filesystem::rename(temporary_path, path);
+	}
+
+	//a snapshot searching the keys and values of an image file in place, nothing is read or copied up front
+	//the header is checked, a file of other types, another version or another byte order is refused
+	//comp must order keys the same way as the comparator of the saved snapshot
+	[[nodiscard]]
+	static FrozenTree open_mapped(const std::filesystem::path& path, const _Compare& comp = _Compare()) requires _is_mappable
+	{
+		auto image = std::make_shared<const MappedFile>(path);
+		auto refuse = [&path](const char* reason) {
+			return std::runtime_error{ "FrozenTree::open_mapped: " + path.string() + ": " + reason };
+		};
+
+		_ImageHeader header;
+		if (image->size() < sizeof(header)) { throw refuse("too short for a header"); }
+		std::memcpy(&header, image->data(), sizeof(header));
+		if (std::memcmp(header.magic, _image_magic, sizeof(header.magic)) != 0) { throw refuse("not an image"); }
+		if (header.version != _image_version) { throw refuse("unknown version"); }
+		if (header.byte_order != _image_byte_order) { throw refuse("other byte order"); }
+		if (header.header_checksum != _header_checksum(header)) { throw refuse("header checksum mismatch"); }
+		if (header.key_size != sizeof(key_type) || header.key_align != alignof(key_type)
+			|| header.value_size != sizeof(value_type) || header.value_align != alignof(value_type))
+		{
+			throw refuse("other key or value type");
+		}
+		std::uint64_t key_count = header.size ? header.size + 1 : 0;
+		if (header.file_size != image->size() || header.size > header.file_size
+			|| header.keys_offset % _image_align != 0 || header.values_offset % _image_align != 0
+			|| header.keys_offset < sizeof(header)
+			|| header.keys_offset + key_count * sizeof(key_type) > header.values_offset
+			|| header.values_offset + header.size * sizeof(value_type) > header.file_size)
+		{
+			throw refuse("arrays out of the file");
+		}
+
+		FrozenTree result;
+		result._size = static_cast<std::size_t>(header.size);
+		result._keys = reinterpret_cast<const key_type*>(image->data() + header.keys_offset);
+		result._values = reinterpret_cast<const value_type*>(image->data() + header.values_offset);
+		result._image = std::move(image);
+		result._comp = comp;
+		return result;
+	}
+
+	//read every key and value and check them against the checksum saved with them
+	//always true for a snapshot made in memory
+	bool verify() const requires _is_mappable
+	{
+		if (!_image) { return true; }
+		_ImageHeader header;
+		std::memcpy(&header, _image->data(), sizeof(header));
+		return header.payload_checksum == _payload_checksum();
+	}
+
+	bool is_mapped() const noexcept { return static_cast<bool>(_image); }
+
+	std::size_t size() const noexcept { return _size; }
+	key_compare key_comp() const { return _comp; }
+
+	//bytes held by the snapshot, without sizeof(FrozenTree)
+	//0 for a mapped one, its pages belong to the page cache
+	std::size_t memory_usage() const noexcept
+	{
+		return _key_storage.capacity() * sizeof(key_type) + _value_storage.capacity() * sizeof(value_type);
+	}
+
+	[[nodiscard]]
+	std::optional<std::reference_wrapper<const value_type>> find(const key_type& key) const
+	{
+		std::size_t k = _bound_index<false>(key);
+		if (k && !_less(key, _keys[k])) { return _values[k - 1]; }
+		else { return std::nullopt; }
+	}
+
+	const_iterator begin() const { return { this, _size ? _leftmost() : 0 }; }
+	const_iterator end() const { return { this, 0 }; }
+	const_iterator cbegin() const { return begin(); }
+	const_iterator cend() const { return end(); }
+
+	const_iterator lower_bound(const key_type& key) const { return { this, _bound_index<false>(key) }; }
+	const_iterator upper_bound(const key_type& key) const { return { this, _bound_index<true>(key) }; }
+	std::pair<const_iterator, const_iterator> equal_range(const key_type& key) const { return { lower_bound(key), upper_bound(key) }; }
+
+private:
+	std::size_t _leftmost() const
+	{
+		std::size_t k = 1;
+		while (2 * k <= _size) { k = 2 * k; }
+		return k;
+	}
+
+	std::size_t _rightmost() const
+	{
+		std::size_t k = 1;
+		while (2 * k + 1 <= _size) { k = 2 * k + 1; }
+		return k;
+	}
+};
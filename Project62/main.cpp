@@ -1,4 +1,4 @@
-#include <concepts>
+﻿#include <concepts>
 #include <memory>
 #include <iostream>
 #include <optional>
@@ -13,6 +13,20 @@
 #include <unordered_map>
 #include <atomic>
 #include <memory_resource>
+#include <algorithm>
+#include <thread>
+#include <string>
+#include <string_view>
+#include <mutex>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include "avl.h"
+#include "wide.h"
+#include "persistent.h"
+#include "concurrent.h"
+#include "sharded.h"
+#include "bench.h"
 
 //std::stack<std::tuple<int, bool>> remove_callstack;
 //std::stack<int> DFS_callstack;
@@ -20,462 +34,6 @@
 
 //#define private public
 
-//concept std::like in C++23
-template<typename T, typename U>
-concept is_cvref_t_of = std::is_same_v<U, std::remove_cvref_t<T>>;
-
-#define UNREACHABLE_BUILDIN_WRAPPER __assume(false)
-#define assert(expression) do { if(!(expression)) { throw std::runtime_error{ "WTF" }; } } while(false)
-
-#define PMR_ENABLE
-
-#ifdef PMR_ENABLE
-std::pmr::monotonic_buffer_resource* memory_buffer;
-#endif // PMR_ENABLE
-
-template<typename _KeyTy, typename _ValTy>
-requires std::totally_ordered<_KeyTy>
-class AVL
-{
-public:
-	using key_type = _KeyTy;
-	using value_type = _ValTy;
-private:
-#define FWD(FORWARD_REF) std::forward<decltype(FORWARD_REF)>(FORWARD_REF)
-
-	enum class is_height_updated : bool
-	{
-		HEIGHT_UPDATE_NO_NEED = false, HEIGHT_UPDATE_NEEDED = true
-	};
-
-	class _Node
-	{
-	public:
-		value_type _value;
-		std::unique_ptr<_Node> _child_left;
-		std::unique_ptr<_Node> _child_right;
-		key_type _key;
-		long long _height = 1;
-
-		_Node(is_cvref_t_of<key_type> auto&& _new_key,
-			is_cvref_t_of<value_type> auto&& _new_value) : 
-			_key(FWD(_new_key)),
-			_value(FWD(_new_value)),
-			_child_left(nullptr), _child_right(nullptr) {}
-
-		_Node(_Node&& _old_node,
-			is_cvref_t_of<value_type> auto&& _new_value) :
-			_key(std::move(_old_node._key)), 
-			_child_left(std::move(_old_node._child_left)), 
-			_child_right(std::move(_old_node._child_right)), 
-			_value(FWD(_new_value)), _height(_old_node._height) {}
-
-		is_height_updated _update_height()
-		{
-			auto new_height = 1 + std::max(_get_height(_child_left), _get_height(_child_right));
-			if (new_height == _height) {
-				return is_height_updated::HEIGHT_UPDATE_NO_NEED;
-			} else {
-				_height = new_height;
-				return is_height_updated::HEIGHT_UPDATE_NEEDED;
-			}
-		}
-
-		long long _get_balance()
-		{
-			return _get_height(_child_right) - _get_height(_child_left);
-		}
-
-#ifdef PMR_ENABLE
-		void* operator new(size_t size)
-		{
-			return memory_buffer->allocate(size);
-		}
-
-		void operator delete(void* memory, size_t size)
-		{
-			memory_buffer->deallocate(memory, size);
-		}
-#endif // PMR_ENABLE
-	};
-
-	static long long _get_height(std::unique_ptr<_Node>& child)
-	{
-		return child ? (child->_height) : 0;
-	}
-
-#define AVL_ROTATE_OPERATION(COUNTER_ROTATE_DIRECTION, ROTATE_DIRECTION)    \
-    auto new_root = std::move(old_root->_child_##COUNTER_ROTATE_DIRECTION); \
-    auto temp_hold = std::move(new_root->_child_##ROTATE_DIRECTION);        \
-    old_root->_child_##COUNTER_ROTATE_DIRECTION = std::move(temp_hold);     \
-    old_root->_update_height();                                             \
-    new_root->_child_##ROTATE_DIRECTION = std::move(old_root);              \
-    new_root->_update_height();                                             \
-    return new_root
-
-	static std::unique_ptr<_Node> _right_rotate(std::unique_ptr<_Node> old_root)
-	{
-		AVL_ROTATE_OPERATION(left, right);
-	}
-
-	static std::unique_ptr<_Node> _left_rotate(std::unique_ptr<_Node> old_root)
-	{
-		AVL_ROTATE_OPERATION(right, left);
-	}
-
-#undef AVL_ROTATE_OPERATION
-
-	std::unique_ptr<_Node>& _find_impl(const key_type& key)
-	{
-		//Not yet got a smart pointer with 'view/reference semantic'
-		//Also miss a rebindable & nullable reference_warpper
-		//std::unique_ptr<_Node>* iter = &(this->_head);
-		//while (*iter)
-		//{
-		//	const key_type& key_now = (*iter)->_key;
-		//	if (key == key_now) { return *iter; }
-		//	if (key > key_now) { iter = &((*iter)->_child_right); }
-		//	else { iter = &((*iter)->_child_left); }
-		//}
-		//return *iter;
-
-		//A weird way to make std::reference_warpper rebindable & nullable
-		std::optional iter = std::ref(this->_head);
-		auto deref = [](auto& i) -> std::unique_ptr<_Node>& { return i.value().get(); };
-		while (deref(iter))
-		{
-			const key_type& key_now = deref(iter)->_key;
-			if (key == key_now) { return deref(iter); }
-			if (key > key_now) { iter.emplace(deref(iter)->_child_right); }
-			else { iter.emplace(deref(iter)->_child_left); }
-		}
-		return deref(iter);
-	}
-
-	static void _rebalance(std::unique_ptr<_Node>& root)
-	{
-		auto balance = root->_get_balance();
-		std::optional child = std::ref(root);
-		auto deref = [](auto& i) -> std::unique_ptr<_Node>&{ return i.value().get(); };
-		unsigned char _case = 0;
-		constexpr char LL = 0b00000000;
-		constexpr char LR = 0b00000001;
-		constexpr char RL = 0b00000010;
-		constexpr char RR = 0b00000011;
-
-		if (balance > 1) {
-			_case |= 0b00000010;
-			child = std::ref(root->_child_right);
-		} else {
-			child = std::ref(root->_child_left);
-		}
-
-		balance = deref(child)->_get_balance();
-		if (balance > 0) {
-			_case |= 0b00000001;
-		}
-
-		switch (_case)
-		{
-		case LR:
-			deref(child) = std::move(_left_rotate(std::move(deref(child))));
-			[[fallthrough]];
-		case LL:
-			root = std::move(_right_rotate(std::move(root)));
-			break;
-		case RL:
-			deref(child) = std::move(_right_rotate(std::move(deref(child))));
-			[[fallthrough]];
-		case RR:
-			root = std::move(_left_rotate(std::move(root)));
-			break;
-		}
-	}
-
-	static is_height_updated _further_update(std::unique_ptr<_Node>& root)
-	{
-		auto balance = root->_get_balance();
-		if (balance > -2 && balance < 2) { //-1, 0, 1 rebalance no need
-			return root->_update_height();
-		}
-
-		//need rebalance
-		auto old_height = _get_height(root);
-		_rebalance(root);
-		//if height is changed, tell parent node that it also needs some check
-		if (old_height != _get_height(root)) { return is_height_updated::HEIGHT_UPDATE_NEEDED; }
-		else { return is_height_updated::HEIGHT_UPDATE_NO_NEED; }
-	}
-
-	is_height_updated _push_impl(
-		std::unique_ptr<_Node>& root,
-		is_cvref_t_of<key_type> auto&& key,
-		is_cvref_t_of<value_type> auto&& value)
-	{
-		if (!root) { //no one is here, so here is the home of new node
-			root = std::make_unique<_Node>(FWD(key), FWD(value));
-			++_size;
-			return is_height_updated::HEIGHT_UPDATE_NEEDED;
-		}
-
-		const key_type& key_now = root->_key;
-		if (key == key_now) { //key has existed, reuse the node and give it new value
-			root = std::make_unique<_Node>(std::move(*root), FWD(value));
-			return is_height_updated::HEIGHT_UPDATE_NO_NEED;
-		}
-
-		[[likely]];
-		//not yet find the right place
-		{
-			//go deeper to one of the children. if height of child remains the same, so does parent's
-			is_height_updated is_further_update_needed = is_height_updated::HEIGHT_UPDATE_NO_NEED;
-			if (key > key_now) {
-				is_further_update_needed = _push_impl(root->_child_right, FWD(key), FWD(value));
-			} else {
-				is_further_update_needed = _push_impl(root->_child_left, FWD(key), FWD(value));
-			}
-
-			if (is_further_update_needed == is_height_updated::HEIGHT_UPDATE_NEEDED) {
-				//height of child updated, need more update and check
-				return _further_update(root);
-			} else {
-				return is_height_updated::HEIGHT_UPDATE_NO_NEED;
-			}
-		}
-	}
-
-	is_height_updated _remove_impl(
-		std::unique_ptr<_Node>& root,
-		is_cvref_t_of<key_type> auto&& key)
-	{
-		//DEBUG
-		//bool marker = false;
-		//struct Guard
-		//{ 
-		//	std::unique_ptr<_Node>& root;
-		//	bool& marker;
-		//	Guard(auto& root, auto& marker) : root(root), marker(marker) {}
-		//	~Guard() { remove_callstack.push({ (root ? root->_key : 1919810), marker}); }
-		//} guard(root, marker);
-
-
-		if (!root) //fail to find a node to remove
-		{
-			[[unlikely]];
-			return is_height_updated::HEIGHT_UPDATE_NO_NEED;
-		}
-
-		const key_type& key_now = root->_key;
-		if (key == key_now) { //succeed to find the node needs removed
-			std::unique_ptr<_Node> ready_to_release = std::move(root);
-			--_size;
-			//from now on, root should not be used until it get the new node to hold
-			//old node will be released at the end of this if scope
-			//use ready_to_release as former root
-
-			//DEBUG
-			//marker = true;
-			//std::cout << ready_to_release->_key << std::endl;
-
-			{
-				if (!(ready_to_release->_child_right))
-				{
-					//if the removing node has no right child, replace it directly with its left child
-					root = std::move(ready_to_release->_child_left);
-				}
-				else if (!(ready_to_release->_child_left))
-				{
-					//do the same thing with left child
-					root = std::move(ready_to_release->_child_right);
-				}
-				else if (!(ready_to_release->_child_left->_child_right))
-				{
-					//deal with the situation when left child tree has no right child
-					//this could not be handled by following part
-					std::unique_ptr<_Node> temp = std::move(ready_to_release->_child_right);
-					root = std::move(ready_to_release->_child_left);
-					root->_child_right = std::move(temp);
-				}
-				else
-				{
-					//find the most right node on the left child tree and let it move to here
-					//NOTE: in a well-maintained AVL tree, such node shall have a left child tree with 0 or 1 height
-					std::unique_ptr<_Node> old_left_child_tree = std::move(ready_to_release->_child_left);
-					std::unique_ptr<_Node> old_right_child_tree = std::move(ready_to_release->_child_right);
-					std::unique_ptr<_Node> new_root;
-
-					//lambda definition
-					auto find_most_right_child_and_replace = 
-						[&new_root]
-					(auto&& self, std::unique_ptr<_Node>& iter_root) -> is_height_updated
-					{
-						auto is_further_update_needed = is_height_updated::HEIGHT_UPDATE_NO_NEED;
-						if (iter_root->_child_right) //not yet the most right node
-						{
-							is_further_update_needed = self(self, iter_root->_child_right);
-						}
-						else
-						{
-							//the most right node is this one
-							//according to the NOTE, only need to replace it with its left child (null or not both OK)
-							//and then this node can be used to replace 'the root'
-							//assert(_get_height(iter_root->_child_left) <= 1);
-							std::unique_ptr<_Node> temp = std::move(iter_root);
-							iter_root = std::move(temp->_child_left);
-							new_root = std::move(temp);
-							//always update this node since it just got into a new place
-							//always inform parents since its child has been replaced
-							if (iter_root) //root could be set to nullptr, which need no update itself, just inform former nodes
-							{
-								_further_update(iter_root);
-							}
-							return is_height_updated::HEIGHT_UPDATE_NEEDED;
-						}
-
-						if (is_further_update_needed == is_height_updated::HEIGHT_UPDATE_NEEDED) {
-							return _further_update(iter_root);
-						} else {
-							return is_height_updated::HEIGHT_UPDATE_NO_NEED;
-						}
-					};
-					//lambda end
-
-					find_most_right_child_and_replace(find_most_right_child_and_replace, old_left_child_tree);
-					//after execution of this lambda, root becomes valid and reachable again
-					new_root->_child_left = std::move(old_left_child_tree);
-					new_root->_child_right = std::move(old_right_child_tree);
-					root = std::move(new_root);
-				}
-			}
-
-			//always update this node since it just got into a new place
-			//always inform parents since its child has been replaced
-			if (root) //root could be set to nullptr, which need no update itself, just inform former nodes
-			{
-				_further_update(root);
-			}
-			return is_height_updated::HEIGHT_UPDATE_NEEDED;
-		}
-
-		//not yet find the node
-		{
-			is_height_updated is_further_update_needed = is_height_updated::HEIGHT_UPDATE_NO_NEED;
-			if (key > key_now) {
-				is_further_update_needed = _remove_impl(root->_child_right, FWD(key));
-			} else {
-				is_further_update_needed = _remove_impl(root->_child_left, FWD(key));
-			}
-
-			if (is_further_update_needed == is_height_updated::HEIGHT_UPDATE_NEEDED) {
-				return _further_update(root);
-			} else {
-				return is_height_updated::HEIGHT_UPDATE_NO_NEED;
-			}
-		}
-	}
-
-	std::unique_ptr<_Node> _head;
-	std::size_t _size;
-
-public:
-	AVL() : _head(), _size(0) {}
-	std::size_t size() { return _size; }
-
-	[[nodiscard]]
-	std::optional<std::reference_wrapper<value_type>> find(const key_type& key)
-	{
-		auto& result = _find_impl(key);
-		if (result) { return result->_value; }
-		else { return std::nullopt; }
-	}
-
-	AVL& insert(
-		is_cvref_t_of<key_type> auto&& key,
-		is_cvref_t_of<value_type> auto&& value)
-	{
-		_push_impl(this->_head, FWD(key), FWD(value));
-		return *this;
-	}
-
-	AVL& erase(is_cvref_t_of<key_type> auto&& key)
-	{
-		_remove_impl(this->_head, FWD(key));
-		return *this;
-	}
-
-	//DEBUG
-	void DFS_impl(std::unique_ptr<_Node>& root)
-	{
-		if (root == nullptr) return;
-		//DFS_callstack.push(root->_key);
-		DFS_impl(root->_child_left);
-		DFS_impl(root->_child_right);
-		//check height
-		try
-		{
-			assert(root->_update_height() == is_height_updated::HEIGHT_UPDATE_NO_NEED);
-		}
-		catch (...)
-		{
-			/*auto& DFScs = DFS_callstack._Get_container();
-			auto& removecs = remove_callstack._Get_container();
-			while (!remove_callstack.empty())
-			{
-				auto& call = remove_callstack.top();
-				std::cout << std::get<int>(call) << ' ' << std::get<bool>(call) << '\n';
-				remove_callstack.pop();
-			}
-			std::cout << '\n';
-			while (!DFS_callstack.empty())
-			{
-				auto DFScall = DFS_callstack.top();
-				std::cout << DFScall << '\n';
-				DFS_callstack.pop();
-			}
-			std::cout << std::flush;*/
-			throw;
-		}
-		//DFS_callstack.pop();
-	}
-
-	//DEBUG
-	void DFS_debug_check()
-	{
-		DFS_impl(this->_head);
-	}
-
-	void another_DFS_impl(std::unique_ptr<_Node>& root, long long depth)
-	{
-		static long long former_depth = -1;
-		if (root == nullptr)
-		{
-			if (former_depth == -1)
-			{
-				[[unlikely]];
-				former_depth = depth;
-			}
-			else
-			{
-				auto diff = depth - former_depth;
-				assert(diff >= -1 && diff <= 1);
-				former_depth = depth;
-			}
-			return;
-		}
-		another_DFS_impl(root->_child_left, depth + 1);
-		another_DFS_impl(root->_child_right, depth + 1);
-	}
-
-	//DEBUG
-	void yet_another_DFS_debug_check()
-	{
-		std::cout.sync_with_stdio(false);
-		another_DFS_impl(_head, 1);
-	}
-};
-
-#undef FWD
-
 //#define TEST constexpr auto
 //
 //template<typename key_type, typename value_type>
@@ -547,6 +105,15 @@ void benchmark_init(int benchmark_size)
     total += dur;                                                   \
     do {} while(false)
 
+//what the container holds in resource after a test, and how much that is per element
+void report_memory(const CountingResource& resource, std::size_t size)
+{
+	std::cout << "Memory: " << resource.live_bytes() << " bytes live, " << resource.peak_bytes() << " bytes peak, "
+		<< resource.allocation_count() << " allocations, fragmentation " << resource.fragmentation();
+	if (size) { std::cout << ", " << static_cast<double>(resource.live_bytes()) / static_cast<double>(size) << " bytes per element"; }
+	std::cout << '\n';
+}
+
 template<template<class...> class T, bool flag>
 void benchmark(const char* name)
 {
@@ -558,13 +125,14 @@ void benchmark(const char* name)
 	auto dur = chrono::duration_cast<chrono::microseconds>(end - start);
 	decltype(dur) total{};
 	std::pmr::monotonic_buffer_resource buff{ 1288490188 };
+	CountingResource counting{ &buff };
 
 	std::cout << "Benchmark name: " << name << '\n';
 	std::cout << "Benchmark start\n";
 
 	std::cout << "Construct test: ";
 	BENCHMARK_START;
-	T<int, double> tree(&buff);
+	T<int, double> tree(&counting);
 	BENCHMARK_END;
 	
 	std::cout << "Insert test: ";
@@ -576,16 +144,39 @@ void benchmark(const char* name)
 		++iter;
 	}
 	BENCHMARK_END;
+	report_memory(counting, tree.size());
 
+	//count hits so the lookups cannot be optimized away
+	std::size_t found = 0;
 	std::cout << "Find test: ";
 	BENCHMARK_START;
 	iter = test_data_out.begin();
 	while (iter != test_data_out.end())
 	{
-		tree.find(*iter);
+		if (tree.find(*iter) != tree.end()) { ++found; }
 		++iter;
 	}
 	BENCHMARK_END;
+	std::cout << "Found: " << found << '\n';
+
+	//sum the values in [key, key + 100) for every tenth lookup key, ordered containers only
+	if constexpr (requires { tree.lower_bound(0); })
+	{
+		double range_sum = 0;
+		std::cout << "Range scan test: ";
+		BENCHMARK_START;
+		for (std::size_t index = 0; index < test_data_out.size(); index += 10)
+		{
+			int low = test_data_out[index];
+			int high = low + 100;
+			for (auto range_iter = tree.lower_bound(low); range_iter != tree.end() && range_iter->first < high; ++range_iter)
+			{
+				range_sum += range_iter->second;
+			}
+		}
+		BENCHMARK_END;
+		std::cout << "Range sum: " << range_sum << '\n';
+	}
 
 	std::cout << "Erase test: ";
 	BENCHMARK_START;
@@ -596,12 +187,32 @@ void benchmark(const char* name)
 		++iter;
 	}
 	BENCHMARK_END;
+	report_memory(counting, tree.size());
+
+	//the insert test keys again, then all dropped at once
+	for (int key : test_data_in) { tree.insert({ key, static_cast<double>(key) }); }
+	std::cout << "Clear test: ";
+	BENCHMARK_START;
+	tree.clear();
+	BENCHMARK_END;
 
 	std::cout << "Total: " << total << '\n';
 	std::cout << "Benchmark end\n" << std::endl;
 }
 
-void benchmark_my()
+//built with AVL_STATS, print what the tree counted since the last report, to read next to the times of the tests before
+void report_stats(auto& tree)
+{
+	if constexpr (avl_stats::is_enabled)
+	{
+		std::cout << tree.stats();
+		tree.reset_stats();
+	}
+}
+
+//_Tree is AVL<int, double> with or without augmentation, the phases only it supports are skipped for the others
+template<typename _Tree>
+void benchmark_my(const char* name, std::pmr::memory_resource* resource)
 {
 	namespace chrono = std::chrono;
 
@@ -611,12 +222,15 @@ void benchmark_my()
 	auto dur = chrono::duration_cast<chrono::microseconds>(end - start);
 	decltype(dur) total{};
 
-	std::cout << "Benchmark name: " << "AVL" << '\n';
+	std::cout << "Benchmark name: " << name << '\n';
 	std::cout << "Benchmark start\n";
 
+	//the trees taking part in the merge test share it, so the merge still only relinks nodes
+	CountingResource counting{ resource };
+
 	std::cout << "Construct test: ";
 	BENCHMARK_START;
-	AVL<int, double> tree;
+	_Tree tree(&counting);
 	BENCHMARK_END;
 	
 	std::cout << "Insert test: ";
@@ -628,16 +242,283 @@ void benchmark_my()
 		++iter;
 	}
 	BENCHMARK_END;
+	report_memory(counting, tree.size());
+	std::cout << "Tree memory usage: " << tree.memory_usage() << " bytes\n";
+	report_stats(tree);
+
+	//same keys as the insert test, already sorted and unique like a snapshot would be
+	{
+		std::vector<std::pair<int, double>> sorted_data;
+		sorted_data.reserve(test_data_in.size());
+		for (int key : test_data_in) { sorted_data.emplace_back(key, static_cast<double>(key)); }
+		std::sort(sorted_data.begin(), sorted_data.end());
+		sorted_data.erase(std::unique(sorted_data.begin(), sorted_data.end()), sorted_data.end());
+
+		_Tree sorted_tree(resource);
+		std::cout << "Sorted build test: ";
+		BENCHMARK_START;
+		sorted_tree.assign_sorted(sorted_data.begin(), sorted_data.end());
+		BENCHMARK_END;
+	}
 
+	//keys only ever growing, like timestamps, one insert at a time
+	//a vector push_back of the same pairs is what the finger is measured against
+	{
+		int key_count = static_cast<int>(test_data_in.size());
+
+		_Tree plain_tree(resource);
+		std::cout << "Append test: ";
+		BENCHMARK_START;
+		for (int key = 0; key < key_count; ++key) { plain_tree.insert(key, static_cast<double>(key)); }
+		BENCHMARK_END;
+
+		_Tree finger_tree(resource);
+		std::cout << "Finger append test: ";
+		BENCHMARK_START;
+		typename _Tree::finger finger(finger_tree);
+		for (int key = 0; key < key_count; ++key) { finger.insert(key, static_cast<double>(key)); }
+		BENCHMARK_END;
+
+		std::pmr::vector<std::pair<int, double>> appended(resource);
+		std::cout << "Vector push_back test: ";
+		BENCHMARK_START;
+		for (int key = 0; key < key_count; ++key) { appended.emplace_back(key, static_cast<double>(key)); }
+		BENCHMARK_END;
+	}
+
+	//count hits so the lookups cannot be optimized away
+	std::size_t found = 0;
 	std::cout << "Find test: ";
 	BENCHMARK_START;
 	iter = test_data_out.begin();
 	while (iter != test_data_out.end())
 	{
-		tree.find(*iter);
+		if (tree.find(*iter)) { ++found; }
+		++iter;
+	}
+	BENCHMARK_END;
+	std::cout << "Found: " << found << '\n';
+	report_stats(tree);
+
+	//same keys again, looked up 16 at a time with their cache misses overlapped
+	{
+		std::vector<typename decltype(tree.find(0))::value_type::type*> results(test_data_out.size());
+		found = 0;
+		std::cout << "Batch find test: ";
+		BENCHMARK_START;
+		tree.find_batch(test_data_out, results);
+		for (auto result : results) { if (result) { ++found; } }
+		BENCHMARK_END;
+		std::cout << "Found: " << found << '\n';
+	}
+
+	//same keys against a read-only snapshot of the tree
+	{
+		std::cout << "Freeze test: ";
+		BENCHMARK_START;
+		auto frozen = tree.freeze();
+		BENCHMARK_END;
+		std::cout << "Frozen memory: " << frozen.memory_usage() << " bytes\n";
+
+		found = 0;
+		std::cout << "Frozen find test: ";
+		BENCHMARK_START;
+		iter = test_data_out.begin();
+		while (iter != test_data_out.end())
+		{
+			if (frozen.find(*iter)) { ++found; }
+			++iter;
+		}
+		BENCHMARK_END;
+		std::cout << "Found: " << found << '\n';
+
+		double bound_sum = 0;
+		std::cout << "Frozen lower_bound test: ";
+		BENCHMARK_START;
+		iter = test_data_out.begin();
+		while (iter != test_data_out.end())
+		{
+			auto bound = frozen.lower_bound(*iter);
+			if (bound != frozen.end()) { bound_sum += bound->second; }
+			++iter;
+		}
+		BENCHMARK_END;
+		std::cout << "Bound sum: " << bound_sum << '\n';
+	}
+
+	//same keys against an image file of the tree, mapped back in with nothing loaded up front
+	{
+		auto image_path = std::filesystem::temp_directory_path() / "avl_benchmark.img";
+		std::cout << "Save test: ";
+		BENCHMARK_START;
+		tree.save(image_path);
+		BENCHMARK_END;
+		std::cout << "Image size: " << std::filesystem::file_size(image_path) << " bytes\n";
+
+		{
+			std::cout << "Open mapped test: ";
+			BENCHMARK_START;
+			auto mapped = _Tree::open_mapped(image_path);
+			BENCHMARK_END;
+
+			//the first lookups page the image in
+			found = 0;
+			std::cout << "Mapped find test: ";
+			BENCHMARK_START;
+			iter = test_data_out.begin();
+			while (iter != test_data_out.end())
+			{
+				if (mapped.find(*iter)) { ++found; }
+				++iter;
+			}
+			BENCHMARK_END;
+			std::cout << "Found: " << found << '\n';
+
+			std::cout << "Verify test: ";
+			BENCHMARK_START;
+			bool is_intact = mapped.verify();
+			BENCHMARK_END;
+			std::cout << "Intact: " << is_intact << '\n';
+		}
+		std::filesystem::remove(image_path);
+	}
+
+	//same ranges as the std::pmr::map benchmark, once through iterators and once through the visitor
+	{
+		double range_sum = 0;
+		std::cout << "Range scan test: ";
+		BENCHMARK_START;
+		for (std::size_t index = 0; index < test_data_out.size(); index += 10)
+		{
+			int low = test_data_out[index];
+			int high = low + 100;
+			for (auto range_iter = tree.lower_bound(low); range_iter != tree.end() && range_iter->first < high; ++range_iter)
+			{
+				range_sum += range_iter->second;
+			}
+		}
+		BENCHMARK_END;
+		std::cout << "Range sum: " << range_sum << '\n';
+
+		range_sum = 0;
+		std::cout << "Range visit test: ";
+		BENCHMARK_START;
+		for (std::size_t index = 0; index < test_data_out.size(); index += 10)
+		{
+			int low = test_data_out[index];
+			tree.for_each_in_range(low, low + 100, [&range_sum](int, double value) { range_sum += value; });
+		}
+		BENCHMARK_END;
+		std::cout << "Range sum: " << range_sum << '\n';
+	}
+
+	//same ranges as the range visit test, answered from the subtree aggregates without visiting the keys
+	if constexpr (requires { tree.aggregate(0, 1); })
+	{
+		double range_sum = 0;
+		std::cout << "Range aggregate test: ";
+		BENCHMARK_START;
+		for (std::size_t index = 0; index < test_data_out.size(); index += 10)
+		{
+			int low = test_data_out[index];
+			range_sum += tree.aggregate(low, low + 100);
+		}
+		BENCHMARK_END;
+		std::cout << "Range sum: " << range_sum << '\n';
+	}
+
+	//subtree sizes answer these without walking the keys
+	if constexpr (requires { tree.rank(0); })
+	{
+		std::size_t rank_sum = 0;
+		std::cout << "Rank test: ";
+		BENCHMARK_START;
+		iter = test_data_out.begin();
+		while (iter != test_data_out.end())
+		{
+			rank_sum += tree.rank(*iter);
+			++iter;
+		}
+		BENCHMARK_END;
+		std::cout << "Rank sum: " << rank_sum << '\n';
+
+		double select_sum = 0;
+		std::cout << "Select test: ";
+		BENCHMARK_START;
+		for (std::size_t index = 0; index < tree.size(); ++index)
+		{
+			select_sum += tree.select(index)->second;
+		}
+		BENCHMARK_END;
+		std::cout << "Select sum: " << select_sum << '\n';
+
+		std::cout << "Median: " << tree.median()->first << '\n';
+	}
+
+	//every key is already in the tree, values are overwritten in place
+	std::cout << "Upsert test: ";
+	BENCHMARK_START;
+	iter = test_data_in.begin();
+	while (iter != test_data_in.end())
+	{
+		tree.insert_or_assign(*iter, static_cast<double>(-*iter));
 		++iter;
 	}
 	BENCHMARK_END;
+	report_stats(tree);
+
+	//a batch of 1% new keys applied as one tree, the way a delta would arrive
+	{
+		_Tree delta(&counting);
+		for (std::size_t index = 0; index < test_data_out.size(); index += 100)
+		{
+			delta.insert(test_data_out[index], static_cast<double>(test_data_out[index]));
+		}
+		std::cout << "Merge test (" << delta.size() << " keys): ";
+		BENCHMARK_START;
+		tree.merge(delta);
+		BENCHMARK_END;
+	}
+
+	//another 1% moved over from a staging tree one entry at a time, relinking the nodes instead of erase and insert
+	{
+		_Tree staging(&counting);
+		std::vector<int> staged_keys;
+		for (std::size_t index = 50; index < test_data_out.size(); index += 100)
+		{
+			staging.insert(test_data_out[index], static_cast<double>(test_data_out[index]));
+			staged_keys.push_back(test_data_out[index]);
+		}
+		auto allocations_before = counting.allocation_count();
+		std::cout << "Node handle test (" << staging.size() << " keys): ";
+		BENCHMARK_START;
+		for (int key : staged_keys) { tree.insert(staging.extract(key)); }
+		BENCHMARK_END;
+		std::cout << "Allocations: " << counting.allocation_count() - allocations_before << '\n';
+	}
+
+	//steady-state insert/erase churn, tree size stays the same so the pool should not grow
+	//a monotonic resource never reuses memory, so only run it against the node pool
+	if (auto pool = dynamic_cast<_Tree::node_pool_type*>(resource))
+	{
+		std::cout << "Churn test: ";
+		auto reserved_before_churn = pool->reserved_bytes();
+		BENCHMARK_START;
+		for (int round = 0; round < 2; ++round)
+		{
+			iter = test_data_in.begin();
+			while (iter != test_data_in.end())
+			{
+				tree.erase(*iter);
+				tree.insert(*iter, static_cast<double>(*iter));
+				++iter;
+			}
+		}
+		BENCHMARK_END;
+		std::cout << "Node pool reserved bytes before churn: " << reserved_before_churn
+			<< ", after churn: " << pool->reserved_bytes() << '\n';
+		report_memory(counting, tree.size());
+	}
 
 	std::cout << "Erase test: ";
 	BENCHMARK_START;
@@ -648,19 +529,462 @@ void benchmark_my()
 		++iter;
 	}
 	BENCHMARK_END;
+	report_memory(counting, tree.size());
+	std::cout << "Tree memory usage: " << tree.memory_usage() << " bytes\n";
+	//merge, churn and erase together
+	report_stats(tree);
+
+	//the insert test keys again, then all dropped at once
+	//straight on the resource, so a monotonic buffer is seen as one and no node is visited
+	{
+		_Tree full(resource);
+		for (int key : test_data_in) { full.insert(key, static_cast<double>(key)); }
+		std::cout << "Clear test: ";
+		BENCHMARK_START;
+		full.clear();
+		BENCHMARK_END;
+	}
+
+	//same keys in a tree with a pool of its own, the pool goes back whole when the tree is destroyed
+	{
+		std::optional<_Tree> own(std::in_place);
+		for (int key : test_data_in) { own->insert(key, static_cast<double>(key)); }
+		std::cout << "Teardown test (own pool): ";
+		BENCHMARK_START;
+		own.reset();
+		BENCHMARK_END;
+	}
+
+	std::cout << "Total: " << total << '\n';
+	std::cout << "Benchmark end\n" << std::endl;
+}
+
+//bulk operations of AVL on the same data with more and more threads
+void benchmark_parallel()
+{
+	namespace chrono = std::chrono;
+
+	auto start = chrono::system_clock::now();
+	auto end = chrono::system_clock::now();
+	auto dur = chrono::duration_cast<chrono::microseconds>(end - start);
+	decltype(dur) total{};
+
+	std::vector<std::pair<int, double>> sorted_data;
+	std::vector<std::pair<int, double>> batch_data;
+	for (int key : test_data_in) { sorted_data.emplace_back(key, static_cast<double>(key)); }
+	for (int key : test_data_out) { batch_data.emplace_back(key, static_cast<double>(key)); }
+	std::sort(sorted_data.begin(), sorted_data.end());
+	sorted_data.erase(std::unique(sorted_data.begin(), sorted_data.end()), sorted_data.end());
+
+	unsigned max_thread_count = std::max(4u, std::thread::hardware_concurrency());
+	for (unsigned thread_count = 1; thread_count <= max_thread_count; thread_count *= 2)
+	{
+		parallel_policy policy{ thread_count };
+		total = {};
+
+		std::cout << "Benchmark name: " << "AVL bulk, " << thread_count << " threads" << '\n';
+		std::cout << "Benchmark start\n";
+
+		AVL<int, double> tree;
+		tree.assign_sorted(sorted_data.begin(), sorted_data.end());
+
+		std::cout << "Bulk insert test: ";
+		BENCHMARK_START;
+		tree.insert_bulk(batch_data.begin(), batch_data.end(), policy);
+		BENCHMARK_END;
+
+		std::cout << "Bulk erase test: ";
+		BENCHMARK_START;
+		tree.erase_bulk(test_data_in.begin(), test_data_in.end(), policy);
+		BENCHMARK_END;
+
+		std::cout << "Merge test: ";
+		{
+			AVL<int, double> delta(tree.get_allocator());
+			delta.assign_sorted(sorted_data.begin(), sorted_data.end());
+			BENCHMARK_START;
+			tree.merge(delta, policy);
+			BENCHMARK_END;
+		}
+
+		std::cout << "Filter test: ";
+		BENCHMARK_START;
+		tree.filter([](int key, double) { return key % 2 == 0; }, policy);
+		BENCHMARK_END;
+
+		std::cout << "Total: " << total << '\n';
+		std::cout << "Benchmark end\n" << std::endl;
+	}
+}
+
+//string keys, where a comparison costs more than a branch
+//both containers use std::less<>, so the lookups go through std::string_view without building a std::string
+void benchmark_string_keys()
+{
+	namespace chrono = std::chrono;
+
+	auto start = chrono::system_clock::now();
+	auto end = chrono::system_clock::now();
+	auto dur = chrono::duration_cast<chrono::microseconds>(end - start);
+	decltype(dur) total{};
+
+	//a shared prefix makes every comparison look past the first few characters
+	std::vector<std::string> keys_in;
+	std::vector<std::string> keys_out;
+	for (int key : test_data_in) { keys_in.push_back("user/session/" + std::to_string(key)); }
+	for (int key : test_data_out) { keys_out.push_back("user/session/" + std::to_string(key)); }
+
+	std::cout << "Benchmark name: " << "string keys, std::pmr::map vs AVL" << '\n';
+	std::cout << "Benchmark start\n";
+
+	std::pmr::map<std::string, double, std::less<>> map;
+	std::cout << "std::pmr::map insert test: ";
+	BENCHMARK_START;
+	for (const auto& key : keys_in) { map.insert_or_assign(key, 1.0); }
+	BENCHMARK_END;
+
+	std::size_t found = 0;
+	std::cout << "std::pmr::map find test: ";
+	BENCHMARK_START;
+	for (const auto& key : keys_out) { if (map.find(std::string_view(key)) != map.end()) { ++found; } }
+	BENCHMARK_END;
+	std::cout << "Found: " << found << '\n';
+
+	AVL<std::string, double, std::less<>> tree;
+	std::cout << "AVL insert test: ";
+	BENCHMARK_START;
+	for (const auto& key : keys_in) { tree.insert_or_assign(key, 1.0); }
+	BENCHMARK_END;
+
+	found = 0;
+	std::cout << "AVL find test: ";
+	BENCHMARK_START;
+	for (const auto& key : keys_out) { if (tree.find(std::string_view(key))) { ++found; } }
+	BENCHMARK_END;
+	std::cout << "Found: " << found << '\n';
+
+	std::cout << "AVL erase test: ";
+	BENCHMARK_START;
+	for (const auto& key : keys_out) { tree.erase(std::string_view(key)); }
+	BENCHMARK_END;
 
 	std::cout << "Total: " << total << '\n';
 	std::cout << "Benchmark end\n" << std::endl;
 }
 
-int main()
+//same keys in AVL and in WideTree, once as ints and once as doubles
+//the wide tree searches a whole node of keys at a time, with AVX2 where the build enables it
+template<typename _KeyTy>
+void benchmark_wide(const char* key_name)
 {
+	namespace chrono = std::chrono;
+
+	auto start = chrono::system_clock::now();
+	auto end = chrono::system_clock::now();
+	auto dur = chrono::duration_cast<chrono::microseconds>(end - start);
+	decltype(dur) total{};
+
+	std::vector<_KeyTy> keys_in;
+	std::vector<_KeyTy> keys_out;
+	for (int key : test_data_in) { keys_in.push_back(static_cast<_KeyTy>(key)); }
+	for (int key : test_data_out) { keys_out.push_back(static_cast<_KeyTy>(key)); }
+
+	std::cout << "Benchmark name: " << key_name << " keys, AVL vs WideTree" << '\n';
+	std::cout << "Benchmark start\n";
+
+	auto run = [&](auto& tree, const char* tree_name) {
+		std::cout << tree_name << " insert test: ";
+		BENCHMARK_START;
+		for (_KeyTy key : keys_in) { tree.insert_or_assign(key, 1.0); }
+		BENCHMARK_END;
+		std::cout << tree_name << " memory usage: " << tree.memory_usage() << " bytes\n";
+
+		std::size_t found = 0;
+		std::cout << tree_name << " find test: ";
+		BENCHMARK_START;
+		for (_KeyTy key : keys_out) { if (tree.find(key)) { ++found; } }
+		BENCHMARK_END;
+		std::cout << "Found: " << found << '\n';
+
+		std::cout << tree_name << " erase test: ";
+		BENCHMARK_START;
+		for (_KeyTy key : keys_out) { tree.erase(key); }
+		BENCHMARK_END;
+	};
+
+	SortedMap<_KeyTy, double, tree_backend::binary> binary_tree;
+	run(binary_tree, "AVL");
+	SortedMap<_KeyTy, double, tree_backend::wide> wide_tree;
+	run(wide_tree, "WideTree");
+
+	std::cout << "Total: " << total << '\n';
+	std::cout << "Benchmark end\n" << std::endl;
+}
+
+//one writer applies the insert data to a persistent tree while readers look up keys in the latest snapshot
+void benchmark_persistent()
+{
+	namespace chrono = std::chrono;
+
+	auto start = chrono::system_clock::now();
+	auto end = chrono::system_clock::now();
+	auto dur = chrono::duration_cast<chrono::microseconds>(end - start);
+	decltype(dur) total{};
+
+	std::cout << "Benchmark name: " << "PersistentAVL, one writer" << '\n';
+	std::cout << "Benchmark start\n";
+
+	PersistentAVL<int, double> tree;
+	std::cout << "Insert test (no reader): ";
+	BENCHMARK_START;
+	for (int key : test_data_in) { tree.insert(key, static_cast<double>(key)); }
+	BENCHMARK_END;
+
+	std::size_t found = 0;
+	std::cout << "Find test: ";
+	BENCHMARK_START;
+	{
+		auto snapshot = tree.get_snapshot();
+		for (int key : test_data_out) { if (snapshot.find(key)) { ++found; } }
+	}
+	BENCHMARK_END;
+	std::cout << "Found: " << found << '\n';
+
+	//readers keep taking a new snapshot every 1000 lookups while the writer erases half of the keys
+	unsigned reader_count = std::max(1u, std::thread::hardware_concurrency() - 1);
+	std::atomic<bool> is_writing{ true };
+	std::atomic<std::size_t> lookup_count{ 0 };
+	std::atomic<std::size_t> hit_count{ 0 };
+	std::vector<std::thread> readers;
+	std::cout << "Erase test (" << reader_count << " readers): ";
+	BENCHMARK_START;
+	for (unsigned reader = 0; reader < reader_count; ++reader)
+	{
+		readers.emplace_back([&tree, &is_writing, &lookup_count, &hit_count, reader] {
+			std::size_t index = reader;
+			std::size_t lookups = 0;
+			std::size_t hits = 0;
+			while (is_writing.load(std::memory_order_relaxed))
+			{
+				auto snapshot = tree.get_snapshot();
+				for (int count = 0; count < 1000; ++count, ++lookups)
+				{
+					index = (index + 7919) % test_data_out.size();
+					if (snapshot.find(test_data_out[index])) { ++hits; }
+				}
+			}
+			lookup_count += lookups;
+			hit_count += hits;
+		});
+	}
+	for (std::size_t index = 0; index < test_data_in.size(); index += 2) { tree.erase(test_data_in[index]); }
+	is_writing = false;
+	for (auto& reader : readers) { reader.join(); }
+	BENCHMARK_END;
+	std::cout << "Lookups during erase: " << lookup_count << ", hits: " << hit_count << ", size after erase: " << tree.size() << '\n';
+
+	std::cout << "Total: " << total << '\n';
+	std::cout << "Benchmark end\n" << std::endl;
+}
+
+//std::map behind one mutex, what ConcurrentAVL is measured against
+class LockedMap
+{
+public:
+	void insert(int key, double value)
+	{
+		std::lock_guard lock(_mutex);
+		_map.insert_or_assign(key, value);
+	}
+
+	bool erase(int key)
+	{
+		std::lock_guard lock(_mutex);
+		return _map.erase(key);
+	}
+
+	std::optional<double> find(int key)
+	{
+		std::lock_guard lock(_mutex);
+		auto iter = _map.find(key);
+		if (iter != _map.end()) { return iter->second; }
+		else { return std::nullopt; }
+	}
+
+private:
+	std::mutex _mutex;
+	std::map<int, double> _map;
+};
+
+//the same mixed workload split over 1 to 64 threads on one shared map: 80% find, 10% insert, 10% erase
+template<typename _Map>
+void benchmark_concurrent(const char* name, const auto&... args)
+{
+	namespace chrono = std::chrono;
+
+	auto start = chrono::system_clock::now();
+	auto end = chrono::system_clock::now();
+	auto dur = chrono::duration_cast<chrono::microseconds>(end - start);
+	decltype(dur) total{};
+
+	std::cout << "Benchmark name: " << name << ", mixed workload" << '\n';
+	std::cout << "Benchmark start\n";
+
+	for (unsigned thread_count = 1; thread_count <= 64; thread_count *= 2)
+	{
+		_Map map(args...);
+		for (int key : test_data_in) { map.insert(key, static_cast<double>(key)); }
+
+		std::size_t operation_count = test_data_out.size() / thread_count;
+		std::atomic<std::size_t> hit_count{ 0 };
+		std::vector<std::thread> workers;
+		std::cout << thread_count << " threads: ";
+		BENCHMARK_START;
+		for (unsigned worker = 0; worker < thread_count; ++worker)
+		{
+			workers.emplace_back([&map, &hit_count, operation_count, worker] {
+				std::size_t hits = 0;
+				std::size_t first = worker * operation_count;
+				for (std::size_t index = first; index < first + operation_count; ++index)
+				{
+					int key = test_data_out[index];
+					switch (index % 10)
+					{
+					case 0:
+						map.insert(key, static_cast<double>(key));
+						break;
+					case 1:
+						map.erase(key);
+						break;
+					default:
+						if (map.find(key)) { ++hits; }
+						break;
+					}
+				}
+				hit_count += hits;
+			});
+		}
+		for (auto& worker : workers) { worker.join(); }
+		BENCHMARK_END;
+		std::cout << "Operations per ms: " << operation_count * thread_count * 1000 / std::max<long long>(1, dur.count())
+			<< ", hits: " << hit_count << '\n';
+	}
+
+	std::cout << "Total: " << total << '\n';
+	std::cout << "Benchmark end\n" << std::endl;
+}
+
+//Project62 suite [--sizes 1000,1000000,100000000] [--workloads zipf,churn] [--warmup 1] [--reps 3]
+//                 [--seed 42] [--format csv|json] [--output path]
+//without --output the report goes to stdout and progress to stderr
+int run_suite(int argc, char* argv[])
+{
+	auto split_list = [](const std::string& list) {
+		std::vector<std::string> items;
+		std::stringstream stream(list);
+		for (std::string item; std::getline(stream, item, ',');) { items.push_back(item); }
+		return items;
+	};
+
+	BenchmarkConfig config;
+	std::string format = "csv";
+	std::string output;
+	for (int index = 2; index + 1 < argc; index += 2)
+	{
+		std::string option = argv[index];
+		std::string value = argv[index + 1];
+		if (option == "--sizes")
+		{
+			config.sizes.clear();
+			for (const auto& size : split_list(value)) { config.sizes.push_back(std::stoull(size)); }
+		}
+		else if (option == "--workloads") { config.workloads = split_list(value); }
+		else if (option == "--warmup") { config.warmup = std::stoull(value); }
+		else if (option == "--reps") { config.repetitions = std::stoull(value); }
+		else if (option == "--seed") { config.seed = std::stoull(value); }
+		else if (option == "--format") { format = value; }
+		else if (option == "--output") { output = value; }
+		else
+		{
+			std::cerr << "unknown option " << option << '\n';
+			return 1;
+		}
+	}
+
+	BenchmarkSuite suite(config);
+	suite.add<std::map<int, double>>("std::map")
+		.add<std::unordered_map<int, double>>("std::unordered_map")
+		.add<std::pmr::map<int, double>>("std::pmr::map")
+		.add<std::pmr::unordered_map<int, double>>("std::pmr::unordered_map")
+		.add<AVL<int, double>>("AVL")
+		.add<AVL<int, double, std::less<int>, true>>("AVL order statistic")
+		.add<AVL<int, double, std::less<int>, false, sum_aggregate<double>>>("AVL range sum")
+		.add<WideTree<int, double>>("WideTree")
+		.add<ConcurrentAVL<int, double>>("ConcurrentAVL")
+		.add<ShardedAVL<int, double>>("ShardedAVL");
+	suite.run(std::cerr);
+
+	std::ofstream file;
+	if (!output.empty()) { file.open(output); }
+	std::ostream& out = output.empty() ? std::cout : file;
+	if (format == "json") { suite.write_json(out); }
+	else { suite.write_csv(out); }
+	return 0;
+}
+
+//a moved-from tree is empty and can be used again, its new nodes must outlive whichever tree goes first
+void check_moved_from_reuse()
+{
+	AVL<int, double> source;
+	source.insert(1, 1.0);
+	AVL<int, double> target = std::move(source);
+	source.insert(2, 2.0);
+	AVL<int, double> assigned;
+	assigned = std::move(target);
+	target.insert(3, 3.0);
+
+	source.DFS_debug_check();
+	target.DFS_debug_check();
+	assigned.DFS_debug_check();
+	if (source.size() != 1 || target.size() != 1 || assigned.size() != 1 || !assigned.find(1))
+	{
+		throw std::runtime_error{ "moved-from AVL lost or shared its nodes" };
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc > 1 && std::string_view(argv[1]) == "suite") { return run_suite(argc, argv); }
+
+	check_moved_from_reuse();
 	benchmark_init(1000000);
 	benchmark<std::pmr::unordered_map, false>("std::pmr::unordered_map");
 	benchmark<std::pmr::map, false>("std::pmr::map");
-	std::pmr::monotonic_buffer_resource buff{ 1288490188 };
-	memory_buffer = &buff;
-	benchmark_my();
+	{
+		std::pmr::monotonic_buffer_resource buff{ 1288490188 };
+		benchmark_my<AVL<int, double>>("AVL (monotonic_buffer_resource)", &buff);
+	}
+	{
+		AVL<int, double>::node_pool_type pool;
+		benchmark_my<AVL<int, double>>("AVL (node pool)", &pool);
+	}
+	{
+		//same run with subtree sizes kept, shows what the augmentation costs on insert / erase
+		AVL<int, double, std::less<int>, true>::node_pool_type pool;
+		benchmark_my<AVL<int, double, std::less<int>, true>>("AVL order statistic (node pool)", &pool);
+	}
+	{
+		AVL<int, double, std::less<int>, false, sum_aggregate<double>>::node_pool_type pool;
+		benchmark_my<AVL<int, double, std::less<int>, false, sum_aggregate<double>>>("AVL range sum (node pool)", &pool);
+	}
+	benchmark_parallel();
+	benchmark_string_keys();
+	benchmark_wide<int>("int");
+	benchmark_wide<double>("double");
+	benchmark_persistent();
+	benchmark_concurrent<LockedMap>("std::map + std::mutex");
+	benchmark_concurrent<ConcurrentAVL<int, double>>("ConcurrentAVL");
+	benchmark_concurrent<ShardedAVL<int, double>>("ShardedAVL, 64 shards", std::size_t{ 64 });
 
 	//AVL<int, double> tree;
 	//auto iter = test_data_in.begin();
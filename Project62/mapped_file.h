@@ -0,0 +1,91 @@
+#pragma once
+#include <cstddef>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//read-only view of a whole file
+//nothing is read when it is opened, the OS brings a page in the first time it is touched
+//and every process mapping the same file shares the same pages of the page cache
+//the file must not be truncated or rewritten in place while it is mapped, replace it with a rename instead
+class MappedFile
+{
+public:
+	explicit MappedFile(const std::filesystem::path& path)
+	{
+#ifdef _WIN32
+		HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+			OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE) { throw std::runtime_error{ "MappedFile: cannot open " + path.string() }; }
+		LARGE_INTEGER file_size;
+		if (!GetFileSizeEx(file, &file_size))
+		{
+			CloseHandle(file);
+			throw std::runtime_error{ "MappedFile: cannot get the size of " + path.string() };
+		}
+		_size = static_cast<std::size_t>(file_size.QuadPart);
+		//an empty file cannot be mapped, it is just an empty view
+		if (_size)
+		{
+			HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (mapping) { _data = static_cast<const std::byte*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)); }
+			//the view keeps the file and the mapping alive by itself
+			if (mapping) { CloseHandle(mapping); }
+		}
+		CloseHandle(file);
+#else
+		int file = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (file < 0) { throw std::runtime_error{ "MappedFile: cannot open " + path.string() }; }
+		struct stat status;
+		if (::fstat(file, &status) != 0)
+		{
+			::close(file);
+			throw std::runtime_error{ "MappedFile: cannot get the size of " + path.string() };
+		}
+		_size = static_cast<std::size_t>(status.st_size);
+		if (_size)
+		{
+			void* data = ::mmap(nullptr, _size, PROT_READ, MAP_SHARED, file, 0);
+			if (data != MAP_FAILED) { _data = static_cast<const std::byte*>(data); }
+		}
+		//the mapping keeps the file alive by itself
+		::close(file);
+#endif
+		if (_size && !_data) { throw std::runtime_error{ "MappedFile: cannot map " + path.string() }; }
+	}
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	~MappedFile()
+	{
+		if (!_data) { return; }
+#ifdef _WIN32
+		UnmapViewOfFile(_data);
+#else
+		::munmap(const_cast<std::byte*>(_data), _size);
+#endif
+	}
+
+	const std::byte* data() const noexcept { return _data; }
+	std::size_t size() const noexcept { return _size; }
+
+private:
+	const std::byte* _data = nullptr;
+	std::size_t _size = 0;
+};
@@ -0,0 +1,294 @@
+#pragma once
+#include <memory>
+#include <atomic>
+#include <optional>
+#include <functional>
+#include <utility>
+#include <algorithm>
+#include <cstdint>
+#include "avl.h"
+
+//AVL whose versions stay readable while one writer keeps updating it
+//nodes never change once linked, insert and erase copy the O(log n) nodes on the path and share the rest
+//every update publishes a new version with one atomic store, a reader takes one with one atomic load
+//and then reads it without any lock for as long as it holds it
+//nodes are reference counted, the ones only an old version uses go away when the last reader drops it
+//so they come from the global heap, a node pool is not safe to free into from reader threads
+//writes must not run concurrently with each other, only with reads
+template<typename _KeyTy, typename _ValTy, typename _Compare = std::less<_KeyTy>>
+requires key_compare_for<_Compare, _KeyTy> && std::copy_constructible<_KeyTy> && std::copy_constructible<_ValTy>
+class PersistentAVL
+{
+public:
+	using key_type = _KeyTy;
+	using value_type = _ValTy;
+	using key_compare = _Compare;
+
+private:
+#define FWD(FORWARD_REF) std::forward<decltype(FORWARD_REF)>(FORWARD_REF)
+
+	class _Node;
+	using _Ptr = std::shared_ptr<const _Node>;
+
+	class _Node
+	{
+	public:
+		key_type _key;
+		std::uint8_t _height;
+		_Ptr _child_left;
+		_Ptr _child_right;
+		value_type _value;
+
+		_Node(auto&& key, auto&& value, _Ptr left, _Ptr right) :
+			_key(FWD(key)),
+			_height(static_cast<std::uint8_t>(1 + std::max(_get_height(left), _get_height(right)))),
+			_child_left(std::move(left)), _child_right(std::move(right)),
+			_value(FWD(value)) {}
+	};
+
+	//what a reader gets from one load, root and size always match
+	struct _Version
+	{
+		_Ptr root;
+		std::size_t size;
+	};
+
+	static int _get_height(const _Ptr& child)
+	{
+		return child ? child->_height : 0;
+	}
+
+	static _Ptr _make(auto&& key, auto&& value, _Ptr left, _Ptr right)
+	{
+		return std::make_shared<const _Node>(FWD(key), FWD(value), std::move(left), std::move(right));
+	}
+
+	//a new node over left and right, which may be one level out of balance after an update below
+	//rotations cannot relink the children in place, they make new copies of the nodes that move
+	static _Ptr _balance(const key_type& key, const value_type& value, _Ptr left, _Ptr right)
+	{
+		int left_height = _get_height(left);
+		int right_height = _get_height(right);
+		if (left_height > right_height + 1)
+		{
+			if (_get_height(left->_child_left) >= _get_height(left->_child_right))
+			{
+				//LL
+				return _make(left->_key, left->_value, left->_child_left,
+					_make(key, value, left->_child_right, std::move(right)));
+			}
+			//LR
+			const _Node& middle = *left->_child_right;
+			return _make(middle._key, middle._value,
+				_make(left->_key, left->_value, left->_child_left, middle._child_left),
+				_make(key, value, middle._child_right, std::move(right)));
+		}
+		if (right_height > left_height + 1)
+		{
+			if (_get_height(right->_child_right) >= _get_height(right->_child_left))
+			{
+				//RR
+				return _make(right->_key, right->_value,
+					_make(key, value, std::move(left), right->_child_left), right->_child_right);
+			}
+			//RL
+			const _Node& middle = *right->_child_left;
+			return _make(middle._key, middle._value,
+				_make(key, value, std::move(left), middle._child_left),
+				_make(right->_key, right->_value, middle._child_right, right->_child_right));
+		}
+		return _make(key, value, std::move(left), std::move(right));
+	}
+
+	//the path is rebuilt on the way back up, an unchanged key still gets a copy holding the new value
+	_Ptr _insert_impl(const _Ptr& root, auto&& key, auto&& value, bool& is_inserted) const
+	{
+		if (!root)
+		{
+			is_inserted = true;
+			return _make(FWD(key), FWD(value), nullptr, nullptr);
+		}
+
+		auto order = key_three_way(_comp, key, root->_key);
+		if (order == 0) { return _make(root->_key, FWD(value), root->_child_left, root->_child_right); }
+		if (order > 0)
+		{
+			return _balance(root->_key, root->_value, root->_child_left,
+				_insert_impl(root->_child_right, FWD(key), FWD(value), is_inserted));
+		}
+		return _balance(root->_key, root->_value,
+			_insert_impl(root->_child_left, FWD(key), FWD(value), is_inserted), root->_child_right);
+	}
+
+	//takes out the least node of root, which comes back in least
+	static _Ptr _erase_least(const _Ptr& root, _Ptr& least)
+	{
+		if (!root->_child_left)
+		{
+			least = root;
+			return root->_child_right;
+		}
+		return _balance(root->_key, root->_value, _erase_least(root->_child_left, least), root->_child_right);
+	}
+
+	//a missing key copies nothing, root comes back as it is
+	_Ptr _erase_impl(const _Ptr& root, const key_type& key, bool& is_erased) const
+	{
+		if (!root) { return root; }
+
+		auto order = key_three_way(_comp, key, root->_key);
+		if (order == 0)
+		{
+			is_erased = true;
+			if (!root->_child_right) { return root->_child_left; }
+			if (!root->_child_left) { return root->_child_right; }
+			_Ptr least;
+			_Ptr right = _erase_least(root->_child_right, least);
+			return _balance(least->_key, least->_value, root->_child_left, std::move(right));
+		}
+
+		if (order > 0)
+		{
+			_Ptr right = _erase_impl(root->_child_right, key, is_erased);
+			if (!is_erased) { return root; }
+			return _balance(root->_key, root->_value, root->_child_left, std::move(right));
+		}
+		_Ptr left = _erase_impl(root->_child_left, key, is_erased);
+		if (!is_erased) { return root; }
+		return _balance(root->_key, root->_value, std::move(left), root->_child_right);
+	}
+
+	void _publish(_Ptr root, std::size_t size)
+	{
+		_current = std::make_shared<const _Version>(std::move(root), size);
+		_published.store(_current, std::memory_order_release);
+	}
+
+	//the writer keeps its own reference to the latest version, so it never has to load _published
+	std::shared_ptr<const _Version> _current;
+	std::atomic<std::shared_ptr<const _Version>> _published;
+	_Compare _comp;
+
+public:
+	//one version of the tree, it never changes and keeps its nodes alive while it exists
+	class snapshot
+	{
+		friend class PersistentAVL;
+
+	public:
+		std::size_t size() const noexcept { return _version->size; }
+
+		[[nodiscard]]
+		std::optional<std::reference_wrapper<const value_type>> find(const key_type& key) const
+		{
+			const _Node* node = _version->root.get();
+			while (node)
+			{
+				auto order = key_three_way(_comp, key, node->_key);
+				if (order == 0) { return node->_value; }
+				node = order > 0 ? node->_child_right.get() : node->_child_left.get();
+			}
+			return std::nullopt;
+		}
+
+		//call func(key, value) for every key in [low, high), in order
+		void for_each_in_range(const key_type& low, const key_type& high, auto&& func) const
+		{
+			_for_each_in_range_impl(_version->root.get(), low, high, func);
+		}
+
+		//call func(key, value) for every key, in order
+		void for_each(auto&& func) const
+		{
+			_for_each_impl(_version->root.get(), func);
+		}
+
+	private:
+		snapshot(std::shared_ptr<const _Version> version, const _Compare& comp) : _version(std::move(version)), _comp(comp) {}
+
+		void _for_each_in_range_impl(const _Node* root, const key_type& low, const key_type& high, auto& func) const
+		{
+			if (!root) { return; }
+			const key_type& key_now = root->_key;
+			if (key_less(_comp, low, key_now)) { _for_each_in_range_impl(root->_child_left.get(), low, high, func); }
+			if (!key_less(_comp, key_now, low) && key_less(_comp, key_now, high)) { func(key_now, root->_value); }
+			if (key_less(_comp, key_now, high)) { _for_each_in_range_impl(root->_child_right.get(), low, high, func); }
+		}
+
+		static void _for_each_impl(const _Node* root, auto& func)
+		{
+			if (!root) { return; }
+			_for_each_impl(root->_child_left.get(), func);
+			func(root->_key, root->_value);
+			_for_each_impl(root->_child_right.get(), func);
+		}
+
+		std::shared_ptr<const _Version> _version;
+		_Compare _comp;
+	};
+
+	PersistentAVL() : PersistentAVL(_Compare()) {}
+	explicit PersistentAVL(const _Compare& comp) : _comp(comp) { _publish(nullptr, 0); }
+
+	PersistentAVL(const PersistentAVL&) = delete;
+	PersistentAVL& operator=(const PersistentAVL&) = delete;
+
+	//the latest version, safe to call from any thread at any time
+	[[nodiscard]]
+	snapshot get_snapshot() const
+	{
+		return { _published.load(std::memory_order_acquire), _comp };
+	}
+
+	//writer side, one thread at a time
+
+	std::size_t size() const noexcept { return _current->size; }
+
+	//the bool is true when key was not in the tree before, an existing value is replaced
+	bool insert_or_assign(
+		is_cvref_t_of<key_type> auto&& key,
+		is_cvref_t_of<value_type> auto&& value)
+	{
+		bool is_inserted = false;
+		_Ptr root = _insert_impl(_current->root, FWD(key), FWD(value), is_inserted);
+		_publish(std::move(root), _current->size + is_inserted);
+		return is_inserted;
+	}
+
+	PersistentAVL& insert(
+		is_cvref_t_of<key_type> auto&& key,
+		is_cvref_t_of<value_type> auto&& value)
+	{
+		insert_or_assign(FWD(key), FWD(value));
+		return *this;
+	}
+
+	//nothing is published when key is not in the tree
+	bool erase(const key_type& key)
+	{
+		bool is_erased = false;
+		_Ptr root = _erase_impl(_current->root, key, is_erased);
+		if (is_erased) { _publish(std::move(root), _current->size - 1); }
+		return is_erased;
+	}
+
+	//DEBUG
+	//check heights and balance of the latest version
+	void DFS_debug_check() const
+	{
+		_check_impl(_current->root.get());
+	}
+
+private:
+	static int _check_impl(const _Node* root)
+	{
+		if (!root) { return 0; }
+		int left_height = _check_impl(root->_child_left.get());
+		int right_height = _check_impl(root->_child_right.get());
+		assert(root->_height == 1 + std::max(left_height, right_height));
+		assert(left_height - right_height >= -1 && left_height - right_height <= 1);
+		return root->_height;
+	}
+};
+
+#undef FWD
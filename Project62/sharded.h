@@ -0,0 +1,342 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <memory>
+#include <vector>
+#include <optional>
+#include <functional>
+#include <utility>
+#include <algorithm>
+#include <iterator>
+#include <thread>
+#include <cstddef>
+#include "avl.h"
+#include "concurrent.h"
+
+//map for many threads built from plain AVLs, each one owning a range of keys
+//every shard has its own lock and its own node pool, threads working on different ranges never share a cache line
+//finds take the lock of their shard shared, inserts and erases take it exclusive
+//the ranges are kept in an immutable routing table, a thread routes a key without any lock,
+//then checks the table is still the current one once it holds the shard lock
+//a table is only replaced while every shard lock is held, old ones are freed by an EpochReclaimer
+//when a shard grows far past or shrinks far below its share, keys move between neighbour shards
+//with split and join, only the moved nodes are copied into the pool of the other shard
+//all trees start empty in the first shard, the others are used from the first rebalance on
+//a rebalance step is O(log n) with _is_order_statistic, the shards then keep subtree sizes
+//without it, finding where to cut a shard and splitting it are O(n), all of it with every shard locked
+template<typename _KeyTy, typename _ValTy, typename _Compare = std::less<_KeyTy>, bool _is_order_statistic = false>
+requires key_compare_for<_Compare, _KeyTy> && std::copy_constructible<_ValTy>
+class ShardedAVL
+{
+public:
+	using key_type = _KeyTy;
+	using value_type = _ValTy;
+	using key_compare = _Compare;
+	using tree_type = AVL<_KeyTy, _ValTy, _Compare, _is_order_statistic>;
+
+private:
+#define FWD(FORWARD_REF) std::forward<decltype(FORWARD_REF)>(FORWARD_REF)
+
+	//below this a shard is never worth rebalancing for, the first one fills up to it before the others are used
+	static constexpr std::size_t _min_rebalance_size = 1024;
+
+	struct alignas(64) _Shard
+	{
+		std::shared_mutex mutex;
+		typename tree_type::node_pool_type pool;
+		tree_type tree;
+
+		explicit _Shard(const _Compare& comp) : tree(comp, &pool) {}
+	};
+
+	//keys less than bounds[0] go to shard 0, keys in [bounds[i - 1], bounds[i]) to shard i
+	//shards past bounds.size() are empty
+	//a shard leaving [lower_limit, upper_limit] asks for a rebalance
+	struct _Routing
+	{
+		std::vector<key_type> bounds;
+		std::size_t upper_limit;
+		std::size_t lower_limit;
+	};
+
+	std::size_t _route(const _Routing& routing, const key_type& key) const
+	{
+		auto bound = std::upper_bound(routing.bounds.begin(), routing.bounds.end(), key,
+			[this](const key_type& lhs, const key_type& rhs) { return key_less(_comp, lhs, rhs); });
+		return static_cast<std::size_t>(bound - routing.bounds.begin());
+	}
+
+	//run func(shard) with the shard of key locked, shared or exclusive
+	//the routing is checked again under the lock, a rebalance in between means routing again
+	template<typename _LockTy>
+	decltype(auto) _with_shard(const key_type& key, auto&& func) const
+	{
+		EpochReclaimer::guard guard(_reclaimer);
+		while (true)
+		{
+			const _Routing* routing = _routing.load(std::memory_order_acquire);
+			_Shard& shard = *_shards[_route(*routing, key)];
+			_LockTy lock(shard.mutex);
+			if (routing == _routing.load(std::memory_order_acquire)) { return func(shard, *routing); }
+		}
+	}
+
+	//every shard, in index order, the same order a range scan takes them in
+	std::vector<std::unique_lock<std::shared_mutex>> _lock_all() const
+	{
+		std::vector<std::unique_lock<std::shared_mutex>> locks;
+		locks.reserve(_shards.size());
+		for (const auto& shard : _shards) { locks.emplace_back(shard->mutex); }
+		return locks;
+	}
+
+	static bool _is_skewed(_Shard& shard, const _Routing& routing)
+	{
+		std::size_t size = shard.tree.size();
+		return size > routing.upper_limit || size < routing.lower_limit;
+	}
+
+	//the index-th smallest key of tree
+	//O(log n) with _is_order_statistic, otherwise an O(n) walk from whichever end is nearer
+	static const key_type& _key_at(tree_type& tree, std::size_t index)
+	{
+		if constexpr (_is_order_statistic) { return tree.select(index).key(); }
+		else if (index < tree.size() / 2) { return std::next(tree.begin(), index).key(); }
+		else { return std::prev(tree.end(), tree.size() - index).key(); }
+	}
+
+	//the count greatest keys of left go to the front of right
+	//right is rebuilt from the moved keys and then joined with what it had, only the moved nodes change pool
+	static void _move_up(_Shard& left, _Shard& right, std::size_t count, key_type& bound)
+	{
+		bound = _key_at(left.tree, left.tree.size() - count);
+		tree_type moved = left.tree.split(bound);
+		tree_type rest = std::move(right.tree);
+		right.tree.join(std::move(moved));
+		right.tree.join(std::move(rest));
+	}
+
+	//the count least keys of right go to the back of left, right keeps at least one key to start its range
+	static void _move_down(_Shard& left, _Shard& right, std::size_t count, key_type& bound)
+	{
+		bound = _key_at(right.tree, count);
+		tree_type rest = right.tree.split(bound);
+		left.tree.join(std::move(right.tree));
+		right.tree = std::move(rest);
+	}
+
+	//with every shard locked, give each one an equal share of the keys, walking from the first shard to the last
+	//a shard above its share passes the excess to the next one, a shard below it takes from the next one
+	void _rebalance_nl()
+	{
+		const _Routing& old_routing = *_routing.load(std::memory_order_relaxed);
+		auto routing = std::make_unique<_Routing>(old_routing);
+
+		std::size_t total = 0;
+		for (const auto& shard : _shards) { total += shard->tree.size(); }
+
+		std::size_t remaining = total;
+		for (std::size_t index = 0; index + 1 < _shards.size(); ++index)
+		{
+			_Shard& shard = *_shards[index];
+			_Shard& next = *_shards[index + 1];
+			std::size_t share = remaining / (_shards.size() - index);
+			std::size_t size = shard.tree.size();
+			bool is_next_used = index < routing->bounds.size();
+
+			if (size > share)
+			{
+				if (!is_next_used) { routing->bounds.push_back(_key_at(shard.tree, 0)); }
+				_move_up(shard, next, size - share, routing->bounds[index]);
+			}
+			else if (size < share && is_next_used && next.tree.size() > 1)
+			{
+				_move_down(shard, next, std::min(share - size, next.tree.size() - 1), routing->bounds[index]);
+			}
+			remaining -= shard.tree.size();
+		}
+
+		std::size_t share = total / _shards.size();
+		routing->upper_limit = 2 * share + _min_rebalance_size;
+		routing->lower_limit = share >= _min_rebalance_size ? share / 4 : 0;
+
+		_routing.store(routing.release(), std::memory_order_release);
+		_reclaimer.retire(const_cast<_Routing*>(&old_routing), [](void* object) { delete static_cast<_Routing*>(object); });
+	}
+
+	//another thread may have rebalanced already while this one waited for the locks
+	void _rebalance_if_skewed()
+	{
+		EpochReclaimer::guard guard(_reclaimer);
+		auto locks = _lock_all();
+		const _Routing& routing = *_routing.load(std::memory_order_relaxed);
+		if (std::any_of(_shards.begin(), _shards.end(), [&routing](const auto& shard) { return _is_skewed(*shard, routing); }))
+		{
+			_rebalance_nl();
+		}
+	}
+
+	std::vector<std::unique_ptr<_Shard>> _shards;
+	std::atomic<const _Routing*> _routing;
+	mutable EpochReclaimer _reclaimer;
+	_Compare _comp;
+
+public:
+	explicit ShardedAVL(std::size_t shard_count = std::max(1u, std::thread::hardware_concurrency()), const _Compare& comp = _Compare()) :
+		_routing(new _Routing{ {}, _min_rebalance_size, 0 }), _comp(comp)
+	{
+		_shards.reserve(std::max<std::size_t>(1, shard_count));
+		for (std::size_t index = 0; index < std::max<std::size_t>(1, shard_count); ++index)
+		{
+			_shards.push_back(std::make_unique<_Shard>(comp));
+		}
+	}
+
+	ShardedAVL(const ShardedAVL&) = delete;
+	ShardedAVL& operator=(const ShardedAVL&) = delete;
+
+	//no other thread may use the map any more
+	~ShardedAVL() { delete _routing.load(); }
+
+	std::size_t shard_count() const noexcept { return _shards.size(); }
+
+	//every shard is counted under its lock, but not all at the same moment
+	std::size_t size() const
+	{
+		std::size_t size = 0;
+		for (const auto& shard : _shards)
+		{
+			std::shared_lock lock(shard->mutex);
+			size += shard->tree.size();
+		}
+		return size;
+	}
+
+	//nodes of all shards, counted like AVL::memory_usage, the pools may hold more
+	std::size_t memory_usage() const
+	{
+		std::size_t bytes = 0;
+		for (const auto& shard : _shards)
+		{
+			std::shared_lock lock(shard->mutex);
+			bytes += shard->tree.memory_usage();
+		}
+		return bytes;
+	}
+
+	//the value is copied out, a reference would outlive the shard lock
+	[[nodiscard]]
+	std::optional<value_type> find(const key_type& key) const
+	{
+		return _with_shard<std::shared_lock<std::shared_mutex>>(key, [&key](_Shard& shard, const _Routing&) -> std::optional<value_type> {
+			auto value = shard.tree.find(key);
+			if (value) { return value->get(); }
+			else { return std::nullopt; }
+		});
+	}
+
+	//the bool is true when key was not in the map before
+	bool insert_or_assign(
+		is_cvref_t_of<key_type> auto&& key,
+		is_cvref_t_of<value_type> auto&& value)
+	{
+		bool is_skewed = false;
+		bool is_inserted = _with_shard<std::unique_lock<std::shared_mutex>>(key, [&](_Shard& shard, const _Routing& routing) {
+			bool inserted = shard.tree.insert_or_assign(FWD(key), FWD(value)).second;
+			is_skewed = inserted && _is_skewed(shard, routing);
+			return inserted;
+		});
+		if (is_skewed) { _rebalance_if_skewed(); }
+		return is_inserted;
+	}
+
+	ShardedAVL& insert(
+		is_cvref_t_of<key_type> auto&& key,
+		is_cvref_t_of<value_type> auto&& value)
+	{
+		insert_or_assign(FWD(key), FWD(value));
+		return *this;
+	}
+
+	//the bool is true when key was in the map
+	bool erase(const key_type& key)
+	{
+		bool is_skewed = false;
+		bool is_erased = _with_shard<std::unique_lock<std::shared_mutex>>(key, [&](_Shard& shard, const _Routing& routing) {
+			std::size_t old_size = shard.tree.size();
+			shard.tree.erase(key);
+			bool erased = shard.tree.size() != old_size;
+			is_skewed = erased && _is_skewed(shard, routing);
+			return erased;
+		});
+		if (is_skewed) { _rebalance_if_skewed(); }
+		return is_erased;
+	}
+
+	//call func(key, value) for every key in [low, high), in order
+	//the shards covering the range are all locked shared before the first call, so the scan sees one consistent state
+	//func must not call back into the map
+	void for_each_in_range(const key_type& low, const key_type& high, auto&& func) const
+	{
+		if (!key_less(_comp, low, high)) { return; }
+
+		EpochReclaimer::guard guard(_reclaimer);
+		while (true)
+		{
+			const _Routing* routing = _routing.load(std::memory_order_acquire);
+			std::size_t first = _route(*routing, low);
+			std::size_t last = _route(*routing, high);
+
+			std::vector<std::shared_lock<std::shared_mutex>> locks;
+			locks.reserve(last - first + 1);
+			for (std::size_t index = first; index <= last; ++index) { locks.emplace_back(_shards[index]->mutex); }
+			if (routing != _routing.load(std::memory_order_acquire)) { continue; }
+
+			for (std::size_t index = first; index <= last; ++index)
+			{
+				std::as_const(_shards[index]->tree).for_each_in_range(low, high, func);
+			}
+			return;
+		}
+	}
+
+	//call func(key, value) for every key, in order, with every shard locked shared
+	void for_each(auto&& func) const
+	{
+		std::vector<std::shared_lock<std::shared_mutex>> locks;
+		locks.reserve(_shards.size());
+		for (const auto& shard : _shards) { locks.emplace_back(shard->mutex); }
+
+		for (const auto& shard : _shards)
+		{
+			for (auto&& [key, value] : std::as_const(shard->tree)) { func(key, value); }
+		}
+	}
+
+	//spread the keys evenly over all shards now, without waiting for a shard to get skewed
+	void rebalance()
+	{
+		EpochReclaimer::guard guard(_reclaimer);
+		auto locks = _lock_all();
+		_rebalance_nl();
+	}
+
+	//DEBUG
+	//only when no other thread uses the map: every shard is a valid AVL and holds only keys of its own range
+	void DFS_debug_check() const
+	{
+		const _Routing& routing = *_routing.load();
+		for (std::size_t index = 0; index < _shards.size(); ++index)
+		{
+			tree_type& tree = _shards[index]->tree;
+			tree.DFS_debug_check();
+			if (index > routing.bounds.size()) { assert(tree.size() == 0); }
+			if (tree.size() == 0) { continue; }
+			if (index > 0) { assert(!key_less(_comp, tree.begin().key(), routing.bounds[index - 1])); }
+			if (index < routing.bounds.size()) { assert(key_less(_comp, std::prev(tree.end()).key(), routing.bounds[index])); }
+		}
+	}
+};
+
+#undef FWD
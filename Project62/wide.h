@@ -0,0 +1,619 @@
+#pragma once
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <optional>
+#include <functional>
+#include <algorithm>
+#include <memory_resource>
+#include <bit>
+#include <type_traits>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#include "avl.h"
+
+//keys a WideTree takes, ordered by < like std::less does
+template<typename _KeyTy>
+concept wide_key = std::is_arithmetic_v<_KeyTy>;
+
+//B+ tree keeping up to _node_keys sorted keys in every node, for arithmetic keys
+//where a descent of AVL pays a cache miss for each key it compares, a node here brings 16 to 64 of them,
+//which are compared with the search key together: 8 ints or 4 doubles per AVX2 instruction where AVX2 is enabled,
+//a loop the compiler vectorizes on its own otherwise
+//inner nodes hold separators and children, keys and values live in the leaves, which are linked in key order
+//insert / insert_or_assign / find / erase / for_each_in_range behave like the ones of AVL
+//there are no iterators, node handles, order statistics or aggregates, AVL is still the tree for those and for complex keys
+template<wide_key _KeyTy, typename _ValTy, std::size_t _node_keys = std::clamp<std::size_t>(256 / sizeof(_KeyTy), 16, 64)>
+requires std::default_initializable<_ValTy> && std::movable<_ValTy> && (_node_keys >= 8 && _node_keys % 8 == 0)
+class WideTree
+{
+public:
+	using key_type = _KeyTy;
+	using value_type = _ValTy;
+	using allocator_type = std::pmr::polymorphic_allocator<>;
+	using key_compare = std::less<_KeyTy>;
+
+private:
+#define FWD(FORWARD_REF) std::forward<decltype(FORWARD_REF)>(FORWARD_REF)
+
+	//a node below the root is merged or refilled when it gets fewer keys than this
+	static constexpr std::uint32_t _min_keys = _node_keys / 2;
+	//every inner node below the root has at least _min_keys + 1 children, so this is never reached
+	static constexpr std::size_t _max_height = 32;
+
+	//keys come first and the node starts a cache line, so a search reads whole lines of keys from the front
+	//keys past _count are left over from earlier moves, the search masks them off
+	struct alignas(64) _Node
+	{
+		key_type _keys[_node_keys]{};
+		std::uint32_t _count = 0;
+	};
+
+	struct _Leaf : _Node
+	{
+		value_type _values[_node_keys]{};
+		_Leaf* _next = nullptr;
+	};
+
+	//the keys of _children[i] are not less than _keys[i - 1] and less than _keys[i]
+	struct _Inner : _Node
+	{
+		_Node* _children[_node_keys + 1]{};
+	};
+
+	//number of keys in keys[0, count) less than key, or not greater than key with _is_upper
+	//keys are sorted, so the lanes that pass are a prefix and the scan stops at the first block that is not full
+	template<bool _is_upper>
+	static std::uint32_t _rank_in(const key_type* keys, std::uint32_t count, key_type key)
+	{
+#if defined(__AVX2__)
+		if constexpr (std::is_same_v<key_type, std::int32_t> || std::is_same_v<key_type, double>)
+		{
+			constexpr std::uint32_t lanes = std::is_same_v<key_type, double> ? 4 : 8;
+			constexpr unsigned full = (1u << lanes) - 1;
+			for (std::uint32_t index = 0; index < count; index += lanes)
+			{
+				unsigned bits;
+				if constexpr (std::is_same_v<key_type, double>)
+				{
+					__m256d block = _mm256_loadu_pd(keys + index);
+					__m256d needle = _mm256_set1_pd(key);
+					bits = static_cast<unsigned>(_mm256_movemask_pd(_mm256_cmp_pd(block, needle, _is_upper ? _CMP_LE_OQ : _CMP_LT_OQ)));
+				}
+				else
+				{
+					__m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + index));
+					__m256i needle = _mm256_set1_epi32(key);
+					//there is no less-or-equal for ints, it is everything but greater
+					__m256i passed = _is_upper ? _mm256_cmpgt_epi32(block, needle) : _mm256_cmpgt_epi32(needle, block);
+					bits = static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(passed)));
+					if constexpr (_is_upper) { bits = ~bits & full; }
+				}
+				std::uint32_t rest = count - index;
+				if (rest < lanes) { bits &= (1u << rest) - 1; }
+				if (bits != full) { return index + static_cast<std::uint32_t>(std::popcount(bits)); }
+			}
+			return count;
+		}
+		else
+#endif
+		{
+			//no branch on the keys, so it vectorizes
+			std::uint32_t rank = 0;
+			for (std::uint32_t index = 0; index < count; ++index)
+			{
+				rank += static_cast<std::uint32_t>(_is_upper ? !(key < keys[index]) : keys[index] < key);
+			}
+			return rank;
+		}
+	}
+
+	_Leaf* _new_leaf()
+	{
+		std::pmr::polymorphic_allocator<_Leaf> alloc{ _alloc };
+		++_leaf_count;
+		return alloc.template new_object<_Leaf>();
+	}
+
+	_Inner* _new_inner()
+	{
+		std::pmr::polymorphic_allocator<_Inner> alloc{ _alloc };
+		++_inner_count;
+		return alloc.template new_object<_Inner>();
+	}
+
+	void _delete_leaf(_Leaf* leaf)
+	{
+		std::pmr::polymorphic_allocator<_Leaf> alloc{ _alloc };
+		--_leaf_count;
+		alloc.delete_object(leaf);
+	}
+
+	void _delete_inner(_Inner* inner)
+	{
+		std::pmr::polymorphic_allocator<_Inner> alloc{ _alloc };
+		--_inner_count;
+		alloc.delete_object(inner);
+	}
+
+	//height is at most _max_height, so the recursion stays shallow
+	void _destroy_impl(_Node* node, std::size_t height)
+	{
+		if (height == 1)
+		{
+			_delete_leaf(static_cast<_Leaf*>(node));
+			return;
+		}
+		_Inner* inner = static_cast<_Inner*>(node);
+		for (std::uint32_t slot = 0; slot <= inner->_count; ++slot) { _destroy_impl(inner->_children[slot], height - 1); }
+		_delete_inner(inner);
+	}
+
+	void _clear_impl()
+	{
+		if (_root) { _destroy_impl(_root, _height); }
+		_root = nullptr;
+		_height = 0;
+		_size = 0;
+	}
+
+	//the leaf key would be in, every inner node on the way and the child taken from it are kept in path and slots
+	_Leaf* _descend(key_type key, _Inner** path, std::uint32_t* slots) const
+	{
+		_Node* node = _root;
+		for (std::size_t level = 0; level + 1 < _height; ++level)
+		{
+			_Inner* inner = static_cast<_Inner*>(node);
+			std::uint32_t slot = _rank_in<true>(inner->_keys, inner->_count, key);
+			path[level] = inner;
+			slots[level] = slot;
+			node = inner->_children[slot];
+		}
+		return static_cast<_Leaf*>(node);
+	}
+
+	_Leaf* _find_leaf(key_type key) const
+	{
+		_Node* node = _root;
+		for (std::size_t level = 1; level < _height; ++level)
+		{
+			_Inner* inner = static_cast<_Inner*>(node);
+			node = inner->_children[_rank_in<true>(inner->_keys, inner->_count, key)];
+		}
+		return static_cast<_Leaf*>(node);
+	}
+
+	value_type* _find_impl(key_type key) const
+	{
+		if (!_root) { return nullptr; }
+		_Leaf* leaf = _find_leaf(key);
+		std::uint32_t slot = _rank_in<false>(leaf->_keys, leaf->_count, key);
+		if (slot < leaf->_count && !(key < leaf->_keys[slot])) { return &(leaf->_values[slot]); }
+		return nullptr;
+	}
+
+	//put separator and the child right of it at slot of inner, which has room for them
+	static void _insert_child(_Inner* inner, std::uint32_t slot, key_type separator, _Node* child)
+	{
+		std::move_backward(inner->_keys + slot, inner->_keys + inner->_count, inner->_keys + inner->_count + 1);
+		std::move_backward(inner->_children + slot + 1, inner->_children + inner->_count + 1, inner->_children + inner->_count + 2);
+		inner->_keys[slot] = separator;
+		inner->_children[slot + 1] = child;
+		++inner->_count;
+	}
+
+	//take the separator at slot of inner and the child right of it out
+	static void _remove_child(_Inner* inner, std::uint32_t slot)
+	{
+		std::move(inner->_keys + slot + 1, inner->_keys + inner->_count, inner->_keys + slot);
+		std::move(inner->_children + slot + 2, inner->_children + inner->_count + 1, inner->_children + slot + 1);
+		--inner->_count;
+	}
+
+	//the value of key, with the bool true when key was not in the tree before
+	template<bool _is_assign>
+	std::pair<value_type*, bool> _push_impl(key_type key, auto&& value)
+	{
+		if (!_root)
+		{
+			_root = _new_leaf();
+			_height = 1;
+		}
+
+		_Inner* path[_max_height];
+		std::uint32_t slots[_max_height];
+		_Leaf* leaf = _descend(key, path, slots);
+		std::uint32_t slot = _rank_in<false>(leaf->_keys, leaf->_count, key);
+		if (slot < leaf->_count && !(key < leaf->_keys[slot])) { //key has existed, reuse the entry
+			if constexpr (_is_assign) { leaf->_values[slot] = FWD(value); }
+			return { &(leaf->_values[slot]), false };
+		}
+
+		++_size;
+		if (leaf->_count < _node_keys)
+		{
+			std::move_backward(leaf->_keys + slot, leaf->_keys + leaf->_count, leaf->_keys + leaf->_count + 1);
+			std::move_backward(leaf->_values + slot, leaf->_values + leaf->_count, leaf->_values + leaf->_count + 1);
+			leaf->_keys[slot] = key;
+			leaf->_values[slot] = FWD(value);
+			++leaf->_count;
+			return { &(leaf->_values[slot]), true };
+		}
+
+		//a full leaf gives its upper half to a new leaf on its right
+		//appending past the last leaf moves nothing, so keys inserted in order fill every leaf
+		_Leaf* right = _new_leaf();
+		std::uint32_t moved = (slot == _node_keys && !leaf->_next) ? 0 : _node_keys - _min_keys;
+		std::uint32_t kept = _node_keys - moved;
+		std::move(leaf->_keys + kept, leaf->_keys + _node_keys, right->_keys);
+		std::move(leaf->_values + kept, leaf->_values + _node_keys, right->_values);
+		leaf->_count = kept;
+		right->_count = moved;
+		right->_next = leaf->_next;
+		leaf->_next = right;
+
+		bool is_left = kept < _node_keys && slot <= kept;
+		_Leaf* home = is_left ? leaf : right;
+		std::uint32_t home_slot = is_left ? slot : slot - kept;
+		std::move_backward(home->_keys + home_slot, home->_keys + home->_count, home->_keys + home->_count + 1);
+		std::move_backward(home->_values + home_slot, home->_values + home->_count, home->_values + home->_count + 1);
+		home->_keys[home_slot] = key;
+		home->_values[home_slot] = FWD(value);
+		++home->_count;
+		value_type* result = &(home->_values[home_slot]);
+
+		//hand the separator and the new node up until an inner node has room for them
+		key_type separator = right->_keys[0];
+		_Node* child = right;
+		for (std::size_t level = _height - 1; level-- > 0;)
+		{
+			_Inner* inner = path[level];
+			std::uint32_t child_slot = slots[level];
+			if (inner->_count < _node_keys)
+			{
+				_insert_child(inner, child_slot, separator, child);
+				return { result, true };
+			}
+
+			//a full inner node splits around its middle key, which goes up
+			key_type keys[_node_keys + 1];
+			_Node* children[_node_keys + 2];
+			std::copy(inner->_keys, inner->_keys + child_slot, keys);
+			keys[child_slot] = separator;
+			std::copy(inner->_keys + child_slot, inner->_keys + _node_keys, keys + child_slot + 1);
+			std::copy(inner->_children, inner->_children + child_slot + 1, children);
+			children[child_slot + 1] = child;
+			std::copy(inner->_children + child_slot + 1, inner->_children + _node_keys + 1, children + child_slot + 2);
+
+			_Inner* right_inner = _new_inner();
+			std::copy(keys, keys + _min_keys, inner->_keys);
+			std::copy(children, children + _min_keys + 1, inner->_children);
+			inner->_count = _min_keys;
+			std::copy(keys + _min_keys + 1, keys + _node_keys + 1, right_inner->_keys);
+			std::copy(children + _min_keys + 1, children + _node_keys + 2, right_inner->_children);
+			right_inner->_count = static_cast<std::uint32_t>(_node_keys - _min_keys);
+
+			separator = keys[_min_keys];
+			child = right_inner;
+		}
+
+		//the root split, the tree grows one level
+		_Inner* root = _new_inner();
+		root->_keys[0] = separator;
+		root->_children[0] = _root;
+		root->_children[1] = child;
+		root->_count = 1;
+		_root = root;
+		++_height;
+		return { result, true };
+	}
+
+	//leaf at slot of parent has too few keys, take one from a sibling or merge with it
+	void _fix_leaf(_Inner* parent, std::uint32_t slot)
+	{
+		_Leaf* leaf = static_cast<_Leaf*>(parent->_children[slot]);
+		_Leaf* left = slot ? static_cast<_Leaf*>(parent->_children[slot - 1]) : nullptr;
+		_Leaf* right = slot < parent->_count ? static_cast<_Leaf*>(parent->_children[slot + 1]) : nullptr;
+
+		if (left && left->_count > _min_keys)
+		{
+			std::move_backward(leaf->_keys, leaf->_keys + leaf->_count, leaf->_keys + leaf->_count + 1);
+			std::move_backward(leaf->_values, leaf->_values + leaf->_count, leaf->_values + leaf->_count + 1);
+			--left->_count;
+			leaf->_keys[0] = left->_keys[left->_count];
+			leaf->_values[0] = std::move(left->_values[left->_count]);
+			++leaf->_count;
+			parent->_keys[slot - 1] = leaf->_keys[0];
+			return;
+		}
+
+		if (right && right->_count > _min_keys)
+		{
+			leaf->_keys[leaf->_count] = right->_keys[0];
+			leaf->_values[leaf->_count] = std::move(right->_values[0]);
+			++leaf->_count;
+			std::move(right->_keys + 1, right->_keys + right->_count, right->_keys);
+			std::move(right->_values + 1, right->_values + right->_count, right->_values);
+			--right->_count;
+			parent->_keys[slot] = right->_keys[0];
+			return;
+		}
+
+		//neither sibling has a key to spare, so both together fit in one leaf
+		//the right one of the two is emptied into the left one
+		if (left) { --slot; }
+		else
+		{
+			left = leaf;
+			leaf = right;
+		}
+		std::move(leaf->_keys, leaf->_keys + leaf->_count, left->_keys + left->_count);
+		std::move(leaf->_values, leaf->_values + leaf->_count, left->_values + left->_count);
+		left->_count += leaf->_count;
+		left->_next = leaf->_next;
+		_remove_child(parent, slot);
+		_delete_leaf(leaf);
+	}
+
+	//same as _fix_leaf for an inner node, the separator in parent goes down and one from the sibling comes up
+	void _fix_inner(_Inner* parent, std::uint32_t slot)
+	{
+		_Inner* inner = static_cast<_Inner*>(parent->_children[slot]);
+		_Inner* left = slot ? static_cast<_Inner*>(parent->_children[slot - 1]) : nullptr;
+		_Inner* right = slot < parent->_count ? static_cast<_Inner*>(parent->_children[slot + 1]) : nullptr;
+
+		if (left && left->_count > _min_keys)
+		{
+			std::move_backward(inner->_keys, inner->_keys + inner->_count, inner->_keys + inner->_count + 1);
+			std::move_backward(inner->_children, inner->_children + inner->_count + 1, inner->_children + inner->_count + 2);
+			inner->_keys[0] = parent->_keys[slot - 1];
+			inner->_children[0] = left->_children[left->_count];
+			++inner->_count;
+			parent->_keys[slot - 1] = left->_keys[left->_count - 1];
+			--left->_count;
+			return;
+		}
+
+		if (right && right->_count > _min_keys)
+		{
+			inner->_keys[inner->_count] = parent->_keys[slot];
+			inner->_children[inner->_count + 1] = right->_children[0];
+			++inner->_count;
+			parent->_keys[slot] = right->_keys[0];
+			std::move(right->_keys + 1, right->_keys + right->_count, right->_keys);
+			std::move(right->_children + 1, right->_children + right->_count + 1, right->_children);
+			--right->_count;
+			return;
+		}
+
+		//the right one of the two is emptied into the left one
+		if (left) { --slot; }
+		else
+		{
+			left = inner;
+			inner = right;
+		}
+		left->_keys[left->_count] = parent->_keys[slot];
+		std::move(inner->_keys, inner->_keys + inner->_count, left->_keys + left->_count + 1);
+		std::move(inner->_children, inner->_children + inner->_count + 1, left->_children + left->_count + 1);
+		left->_count += inner->_count + 1;
+		_remove_child(parent, slot);
+		_delete_inner(inner);
+	}
+
+	bool _remove_impl(key_type key)
+	{
+		if (!_root) { return false; }
+
+		_Inner* path[_max_height];
+		std::uint32_t slots[_max_height];
+		_Leaf* leaf = _descend(key, path, slots);
+		std::uint32_t slot = _rank_in<false>(leaf->_keys, leaf->_count, key);
+		if (slot == leaf->_count || key < leaf->_keys[slot]) { return false; }
+
+		std::move(leaf->_keys + slot + 1, leaf->_keys + leaf->_count, leaf->_keys + slot);
+		std::move(leaf->_values + slot + 1, leaf->_values + leaf->_count, leaf->_values + slot);
+		--leaf->_count;
+		--_size;
+
+		//refill nodes from the leaf up, as long as they are left with too few keys
+		_Node* node = leaf;
+		for (std::size_t level = _height - 1; level > 0 && node->_count < _min_keys; --level)
+		{
+			if (level == _height - 1) { _fix_leaf(path[level - 1], slots[level - 1]); }
+			else { _fix_inner(path[level - 1], slots[level - 1]); }
+			node = path[level - 1];
+		}
+
+		//a root left with one child hands the tree down to it, an empty root leaf goes away
+		if (_height > 1 && _root->_count == 0)
+		{
+			_Inner* root = static_cast<_Inner*>(_root);
+			_root = root->_children[0];
+			_delete_inner(root);
+			--_height;
+		}
+		else if (_height == 1 && _root->_count == 0)
+		{
+			_delete_leaf(static_cast<_Leaf*>(_root));
+			_root = nullptr;
+			_height = 0;
+		}
+		return true;
+	}
+
+public:
+	//nodes come from the default resource, they are big enough that a pool of fixed size blocks would gain little
+	WideTree() = default;
+	//same as std::pmr::map, a memory_resource* converts to the allocator
+	explicit WideTree(const allocator_type& alloc) : _alloc(alloc) {}
+
+	WideTree(const WideTree&) = delete;
+	WideTree& operator=(const WideTree&) = delete;
+
+	WideTree(WideTree&& other) noexcept :
+		_alloc(other._alloc), _root(std::exchange(other._root, nullptr)), _height(std::exchange(other._height, 0)),
+		_size(std::exchange(other._size, 0)), _leaf_count(std::exchange(other._leaf_count, 0)),
+		_inner_count(std::exchange(other._inner_count, 0)) {}
+
+	WideTree& operator=(WideTree&& other) noexcept
+	{
+		if (this != &other)
+		{
+			_clear_impl();
+			//nodes keep living in the resource they were allocated from
+			std::destroy_at(&_alloc);
+			std::construct_at(&_alloc, other._alloc);
+			_root = std::exchange(other._root, nullptr);
+			_height = std::exchange(other._height, 0);
+			_size = std::exchange(other._size, 0);
+			_leaf_count = std::exchange(other._leaf_count, 0);
+			_inner_count = std::exchange(other._inner_count, 0);
+		}
+		return *this;
+	}
+
+	~WideTree() { _clear_impl(); }
+
+	void clear() { _clear_impl(); }
+
+	std::size_t size() const { return _size; }
+	bool empty() const { return !_size; }
+	//levels from the root to the leaves, 0 for an empty tree
+	std::size_t height() const { return _height; }
+
+	//bytes of every node, leaves are only partly filled so this is more than size() entries would take
+	std::size_t memory_usage() const noexcept { return _leaf_count * sizeof(_Leaf) + _inner_count * sizeof(_Inner); }
+
+	allocator_type get_allocator() const noexcept { return _alloc; }
+	key_compare key_comp() const { return {}; }
+
+	[[nodiscard]]
+	std::optional<std::reference_wrapper<value_type>> find(key_type key)
+	{
+		if (value_type* value = _find_impl(key)) { return *value; }
+		return std::nullopt;
+	}
+
+	[[nodiscard]]
+	std::optional<std::reference_wrapper<const value_type>> find(key_type key) const
+	{
+		if (const value_type* value = _find_impl(key)) { return *value; }
+		return std::nullopt;
+	}
+
+	//call func(key, value) for every key in [low, high), in order
+	void for_each_in_range(key_type low, key_type high, auto&& func)
+	{
+		if (!_root) { return; }
+		_Leaf* leaf = _find_leaf(low);
+		std::uint32_t slot = _rank_in<false>(leaf->_keys, leaf->_count, low);
+		while (leaf)
+		{
+			for (; slot < leaf->_count; ++slot)
+			{
+				if (!(leaf->_keys[slot] < high)) { return; }
+				func(std::as_const(leaf->_keys[slot]), leaf->_values[slot]);
+			}
+			leaf = leaf->_next;
+			slot = 0;
+		}
+	}
+
+	void for_each_in_range(key_type low, key_type high, auto&& func) const
+	{
+		const_cast<WideTree*>(this)->for_each_in_range(low, high,
+			[&func](const key_type& key, const value_type& value) { func(key, value); });
+	}
+
+	WideTree& insert(key_type key, is_cvref_t_of<value_type> auto&& value)
+	{
+		_push_impl<true>(key, FWD(value));
+		return *this;
+	}
+
+	//the bool is true when key was not in the tree before
+	std::pair<std::reference_wrapper<value_type>, bool> insert_or_assign(key_type key, is_cvref_t_of<value_type> auto&& value)
+	{
+		auto [found, is_inserted] = _push_impl<true>(key, FWD(value));
+		return { *found, is_inserted };
+	}
+
+	//value is only stored when key is not in the tree yet
+	std::pair<std::reference_wrapper<value_type>, bool> try_insert(key_type key, is_cvref_t_of<value_type> auto&& value)
+	{
+		auto [found, is_inserted] = _push_impl<false>(key, FWD(value));
+		return { *found, is_inserted };
+	}
+
+	WideTree& erase(key_type key)
+	{
+		_remove_impl(key);
+		return *this;
+	}
+
+	//checks the order of keys and separators, the fill of every node and the leaf links, throws when one is broken
+	void debug_check() const
+	{
+		std::size_t counted = 0;
+		const _Leaf* previous = nullptr;
+		auto check = [&](auto& self, const _Node* node, std::size_t height, const key_type* low, const key_type* high) -> void {
+			if (node != _root && node->_count < (height == 1 ? 1u : _min_keys)) { throw std::runtime_error{ "WideTree: underfull node" }; }
+			for (std::uint32_t slot = 0; slot < node->_count; ++slot)
+			{
+				if (slot && !(node->_keys[slot - 1] < node->_keys[slot])) { throw std::runtime_error{ "WideTree: keys out of order" }; }
+				if ((low && node->_keys[slot] < *low) || (high && !(node->_keys[slot] < *high))) { throw std::runtime_error{ "WideTree: key out of its subtree" }; }
+			}
+			if (height == 1)
+			{
+				const _Leaf* leaf = static_cast<const _Leaf*>(node);
+				if (previous && previous->_next != leaf) { throw std::runtime_error{ "WideTree: broken leaf link" }; }
+				previous = leaf;
+				counted += leaf->_count;
+				return;
+			}
+			const _Inner* inner = static_cast<const _Inner*>(node);
+			for (std::uint32_t slot = 0; slot <= inner->_count; ++slot)
+			{
+				self(self, inner->_children[slot], height - 1,
+					slot ? &(inner->_keys[slot - 1]) : low, slot < inner->_count ? &(inner->_keys[slot]) : high);
+			}
+		};
+		if (_root) { check(check, _root, _height, nullptr, nullptr); }
+		if (previous && previous->_next) { throw std::runtime_error{ "WideTree: broken leaf link" }; }
+		if (counted != _size) { throw std::runtime_error{ "WideTree: wrong size" }; }
+	}
+
+private:
+	allocator_type _alloc;
+	_Node* _root = nullptr;
+	std::size_t _height = 0;
+	std::size_t _size = 0;
+	std::size_t _leaf_count = 0;
+	std::size_t _inner_count = 0;
+};
+
+//the two trees a SortedMap can be made of, binary is AVL, wide is WideTree
+enum class tree_backend { binary, wide };
+
+template<typename _KeyTy, typename _ValTy, tree_backend _backend>
+struct sorted_map_of
+{
+	using type = AVL<_KeyTy, _ValTy>;
+};
+
+template<typename _KeyTy, typename _ValTy>
+struct sorted_map_of<_KeyTy, _ValTy, tree_backend::wide>
+{
+	using type = WideTree<_KeyTy, _ValTy>;
+};
+
+//ordered map with the backend picked by a template parameter, both take the same insert / find / erase calls
+//it is wide for the keys and values WideTree takes unless asked otherwise
+template<typename _KeyTy, typename _ValTy,
+	tree_backend _backend = (wide_key<_KeyTy> && std::default_initializable<_ValTy>) ? tree_backend::wide : tree_backend::binary>
+using SortedMap = typename sorted_map_of<_KeyTy, _ValTy, _backend>::type;
+
+#undef FWD